@@ -0,0 +1,84 @@
+#include "vectormap.hpp"
+#include "vectormap_allocator.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+/**
+ * @brief Scan throughput of a large vectormap<double, double> with std::allocator, transparent
+ *        huge pages and NUMA interleaving.
+ *
+ *        bench_allocator [elements] [repetitions]
+ */
+
+using value_type = std::pair<const double, double>;
+
+constexpr com::huge_page_policy interleaved{.numa = com::numa_policy::interleave};
+
+using clock_type = std::chrono::steady_clock;
+
+template<class map>
+void run(const char* name, size_t elements, size_t repetitions) {
+    map m;
+    m.reserve(elements);
+    for (size_t i = 0; i < elements; ++i) {
+        m.emplace_back(double(i), double(i % 7));
+    }
+
+    std::mt19937_64 rng(42);
+    std::vector<size_t> positions(elements / 8);
+    for (auto& p : positions) {
+        p = rng() % elements;
+    }
+
+    double bytes = double(elements) * sizeof(value_type);
+    double sequential = 0, parallel = 0, random = 0, sink = 0;
+
+    for (size_t r = 0; r < repetitions; ++r) {
+        auto t0 = clock_type::now();
+        double sum = 0;
+        for (const auto& elem : m) {
+            sum += elem.second;
+        }
+        auto t1 = clock_type::now();
+
+        std::vector<double> partial(std::thread::hardware_concurrency() + 1, 0);
+        std::atomic<size_t> slot = 0;
+        com::detail::parallel_for(elements, com::parallel_t::grain, [&](size_t begin, size_t end) {
+            double s = 0;
+            for (size_t i = begin; i < end; ++i) {
+                s += m.data()[i].second;
+            }
+            partial[slot++ % partial.size()] += s;
+        });
+        auto t2 = clock_type::now();
+
+        for (size_t p : positions) {
+            sum += m.data()[p].second;
+        }
+        auto t3 = clock_type::now();
+
+        sequential += std::chrono::duration<double>(t1 - t0).count();
+        parallel += std::chrono::duration<double>(t2 - t1).count();
+        random += std::chrono::duration<double>(t3 - t2).count();
+        sink += sum + partial[0];
+    }
+
+    std::printf("%-14s  scan %7.2f GB/s  parallel scan %7.2f GB/s  random reads %7.1f M/s  (%g)\n", name,
+                bytes * repetitions / sequential / 1e9, bytes * repetitions / parallel / 1e9,
+                double(positions.size()) * repetitions / random / 1e6, sink);
+}
+
+int main(int argc, char** argv) {
+    size_t elements = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 20000000;
+    size_t repetitions = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 5;
+
+    std::printf("%zu elements, %zu MiB\n", elements, elements * sizeof(value_type) >> 20);
+    run<com::vectormap<double, double, 100>>("std::allocator", elements, repetitions);
+    run<com::vectormap<double, double, 100, com::huge_page_allocator<value_type>>>("huge pages", elements, repetitions);
+    run<com::vectormap<double, double, 100, com::huge_page_allocator<value_type, interleaved>>>("interleaved", elements, repetitions);
+    return 0;
+}
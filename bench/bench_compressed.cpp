@@ -0,0 +1,69 @@
+#include "vectormap.hpp"
+#include "compressed_vectormap.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+/**
+ * @brief Memory and read throughput of a compressed value column against a plain vectormap.
+ *
+ *        bench_compressed [elements] [repetitions]
+ */
+
+using clock_type = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    size_t elements = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 5000000;
+    size_t repetitions = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 5;
+
+    std::mt19937_64 rng(42);
+    com::vectormap<std::string, size_t> plain;
+    plain.reserve(elements);
+    for (size_t i = 0; i < elements; ++i) {
+        plain.emplace_back("k" + std::to_string(i % 1000), rng() % 4096);
+    }
+    com::compressed_vectormap<std::string, size_t> packed(plain);
+
+    std::vector<size_t> positions(elements / 8);
+    for (auto& p : positions) {
+        p = rng() % elements;
+    }
+
+    double plain_scan = 0, packed_scan = 0, plain_random = 0, packed_random = 0;
+    size_t sink = 0;
+    for (size_t r = 0; r < repetitions; ++r) {
+        auto t0 = clock_type::now();
+        for (const auto& elem : plain) {
+            sink += elem.second;
+        }
+        auto t1 = clock_type::now();
+        packed.for_each([&](const std::string&, size_t val) { sink += val; });
+        auto t2 = clock_type::now();
+        for (size_t p : positions) {
+            sink += plain.get_value(p);
+        }
+        auto t3 = clock_type::now();
+        for (size_t p : positions) {
+            sink += packed.get_value(p);
+        }
+        auto t4 = clock_type::now();
+
+        plain_scan += std::chrono::duration<double>(t1 - t0).count();
+        packed_scan += std::chrono::duration<double>(t2 - t1).count();
+        plain_random += std::chrono::duration<double>(t3 - t2).count();
+        packed_random += std::chrono::duration<double>(t4 - t3).count();
+    }
+
+    double n = double(elements) * repetitions;
+    double m = double(positions.size()) * repetitions;
+    std::printf("%zu elements\n", elements);
+    std::printf("value column   plain %8.1f MiB  compressed %8.1f MiB  (%.1fx)\n", elements * sizeof(size_t) / 1048576.0,
+                packed.value_bytes() / 1048576.0, double(elements * sizeof(size_t)) / double(packed.value_bytes()));
+    std::printf("scan           plain %8.1f M/s  compressed %8.1f M/s\n", n / plain_scan / 1e6, n / packed_scan / 1e6);
+    std::printf("random reads   plain %8.1f M/s  compressed %8.1f M/s\n", m / plain_random / 1e6, m / packed_random / 1e6);
+    std::printf("(%zu)\n", sink);
+    return 0;
+}
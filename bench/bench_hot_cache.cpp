@@ -0,0 +1,61 @@
+#include "vectormap.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+/**
+ * @brief Key lookups with and without the hot key cache, for a skewed workload whose hot keys
+ *        sit far from the beginning. Every edit_every lookups an element is moved, which
+ *        invalidates the cached positions.
+ *
+ *        bench_hot_cache [elements] [lookups] [edit_every]
+ */
+
+using clock_type = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    size_t elements = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 10000;
+    size_t lookups = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 200000;
+    size_t edit_every = (argc > 3) ? std::strtoull(argv[3], nullptr, 10) : 0;
+
+    com::vectormap<std::string, size_t> m;
+    m.reserve(elements);
+    for (size_t i = 0; i < elements; ++i) {
+        m.emplace_back("k" + std::to_string(i), i);
+    }
+
+    // Zipf-like ranks, mapped so the most popular keys are the last ones.
+    std::mt19937_64 rng(42);
+    std::vector<std::string> keys(lookups);
+    for (auto& k : keys) {
+        double u = std::uniform_real_distribution<double>(0, 1)(rng);
+        size_t rank = size_t(std::pow(double(elements), u)) - 1;
+        k = "k" + std::to_string(elements - 1 - rank % elements);
+    }
+
+    auto run = [&](size_t entries) {
+        m.set_hot_cache(entries);
+        size_t sink = 0;
+        auto t0 = clock_type::now();
+        for (size_t i = 0; i < lookups; ++i) {
+            if ((edit_every != 0) && (i % edit_every == 0)) {
+                m.move(0, 1);
+            }
+            sink += m.get_pos(keys[i]).size();
+        }
+        auto t1 = clock_type::now();
+        double seconds = std::chrono::duration<double>(t1 - t0).count();
+        com::hot_cache_stats stats = m.get_hot_cache_stats();
+        std::printf("cache %5zu  %10.3f M lookups/s  hits %zu  misses %zu  (%zu)\n", entries, lookups / seconds / 1e6, stats.hits, stats.misses, sink);
+    };
+
+    std::printf("%zu elements, %zu lookups, edit every %zu\n", elements, lookups, edit_every);
+    run(0);
+    run(16);
+    run(64);
+    return 0;
+}
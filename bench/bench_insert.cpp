@@ -0,0 +1,41 @@
+#include "vectormap.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+/**
+ * @brief Insertions at random positions of a vectormap<std::string, size_t> whose capacity is
+ *        already reserved, so every insertion shifts the elements after it in place.
+ *
+ *        bench_insert [elements] [insertions]
+ */
+
+using clock_type = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    size_t elements = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 20000;
+    size_t insertions = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 2000;
+
+    com::vectormap<std::string, size_t> m;
+    m.reserve(elements + insertions);
+    for (size_t i = 0; i < elements; ++i) {
+        m.emplace_back("k" + std::to_string(i), i);
+    }
+
+    std::mt19937_64 rng(42);
+    size_t moved = 0;
+    auto t0 = clock_type::now();
+    for (size_t i = 0; i < insertions; ++i) {
+        size_t pos = std::uniform_int_distribution<size_t>(0, m.size())(rng);
+        moved += m.size() - pos;
+        m.insert("n" + std::to_string(i), i, pos);
+    }
+    auto t1 = clock_type::now();
+
+    double seconds = std::chrono::duration<double>(t1 - t0).count();
+    std::printf("%zu elements, %zu insertions: %.3f s, %.1f ns per shifted element\n", elements, insertions, seconds, seconds * 1e9 / double(moved));
+    return 0;
+}
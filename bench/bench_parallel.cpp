@@ -0,0 +1,57 @@
+#include "vectormap.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+/**
+ * @brief Scaling of the parallel copy, resize and destruction of a vectormap<std::string, size_t>
+ *        with the number of threads.
+ *
+ *        bench_parallel [elements] [max threads]
+ */
+
+using vmap = com::vectormap<std::string, size_t>;
+using clock_type = std::chrono::steady_clock;
+
+static double seconds(clock_type::time_point from, clock_type::time_point to) {
+    return std::chrono::duration<double>(to - from).count();
+}
+
+int main(int argc, char** argv) {
+    size_t elements = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 5000000;
+    size_t max_threads = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : std::max(1u, std::thread::hardware_concurrency());
+
+    vmap source;
+    source.reserve(elements);
+    for (size_t i = 0; i < elements; ++i) {
+        // Longer than the small string buffer, so every copy allocates.
+        source.emplace_back("key_with_a_long_prefix_" + std::to_string(i), i);
+    }
+
+    std::printf("%zu elements, %u hardware threads\n", elements, std::thread::hardware_concurrency());
+    std::printf("threads      copy ms   resize ms  destroy ms\n");
+
+    for (size_t threads = 0; threads <= max_threads; threads = (threads == 0) ? 1 : threads * 2) {
+        // threads == 0 is the serial path.
+        if (threads == 0) {
+            source.set_parallel_threshold(vmap::npos);
+        }
+        else {
+            source.set_parallel_threshold(0, threads);
+        }
+
+        auto t0 = clock_type::now();
+        vmap* copy = new vmap(source);
+        auto t1 = clock_type::now();
+        copy->resize(copy->capacity() * 2);
+        auto t2 = clock_type::now();
+        delete copy;
+        auto t3 = clock_type::now();
+
+        std::printf("%-9s %10.1f  %10.1f  %10.1f\n", (threads == 0) ? "serial" : std::to_string(threads).c_str(),
+                    seconds(t0, t1) * 1e3, seconds(t1, t2) * 1e3, seconds(t2, t3) * 1e3);
+    }
+    return 0;
+}
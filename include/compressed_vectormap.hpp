@@ -0,0 +1,450 @@
+#ifndef __COMPRESSEDVECTORMAP_H__
+#define __COMPRESSEDVECTORMAP_H__
+
+#include "vectormap.hpp"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <concepts>
+#include <initializer_list>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace com {
+    /**
+     * @brief Vectormap with an integral value column compressed with frame-of-reference bit packing.\n
+     *        The values are split in blocks of block_ elements. Every block stores its minimum and the
+     *        differences to it with the bits the widest one needs, so small counters take a few bits
+     *        instead of sizeof(value_). The keys are stored as they are.\n
+     *        It supports appending and updating values; positional insertions and erasures are done
+     *        on a vectormap obtained with decompress().
+     *
+     * @tparam key_   Type of the key.
+     * @tparam value_ Integral type of the value.
+     * @tparam block_ Number of values per block.
+     */
+    template<DefaultInitializableKeyable key_, std::integral value_, size_t block_ = 128>
+    class compressed_vectormap
+    {
+        static_assert(block_ > 0, "block_ must not be 0");
+
+        public:
+            /** @cond */
+            using key_type = key_;
+            using mapped_type = value_;
+            using value_type = std::pair<const key_type, mapped_type>;
+            using size_type = size_t;
+
+            static constexpr size_type npos = std::numeric_limits<size_type>::max();
+            static constexpr size_type block_size = block_;
+            /** @endcond */
+
+            /** @name Constructors */
+            /** @{ */
+            compressed_vectormap() = default;
+            compressed_vectormap(const std::initializer_list<value_type>& il);
+            /**
+             * @brief Compresses the elements of a vectormap.
+             *
+             */
+            template<size_t delta_, class alloc_>
+            explicit compressed_vectormap(const vectormap<key_, value_, delta_, alloc_>& map);
+            /** @} */
+
+            /** @name Insertion */
+            /** @{ */
+            void push_back(const key_type& key, const mapped_type val);
+            /** @} */
+
+            /** @name Element access */
+            /** @{ */
+            /**
+             * @brief Value at a position. Only the bits of that value are read, not the whole block.
+             *
+             * @return mapped_type  The value, or a default one if pos is out of range.
+             */
+            mapped_type get_value(const size_type pos) const;
+            mapped_type get_value(const key_type& key, size_type ordinal = 1) const { return get_value(get_pos(key, ordinal)); }
+            const key_type& get_key(const size_type pos) const { return pos < keys_.size() ? keys_[pos] : void_key_type_; }
+            size_type get_pos(const key_type& key, size_type ordinal = 1) const;
+            bool contains(const key_type& key) const { return get_pos(key) != npos; }
+            /**
+             * @brief Decodes consecutive values, a whole block at a time.
+             *
+             * @param first       Position of the first value.
+             * @param out         Receives the values from first on.
+             * @return size_type  Number of values written: min(out.size(), size() - first).
+             */
+            size_type decode(size_type first, std::span<mapped_type> out) const;
+            /**
+             * @brief Calls fn(key, value) for every element in order, decoding a block at a time.
+             *
+             */
+            template<class Fn>
+                requires std::invocable<Fn&, const key_type&, mapped_type>
+            void for_each(Fn fn) const;
+            /** @} */
+
+            /** @name  Element modification */
+            /** @{ */
+            /**
+             * @brief Replaces a value. If it does not fit the bits of its block the block is re-encoded.\n
+             *        A block that needs more words moves to the end of the word array instead of shifting
+             *        the blocks after it. The words left behind are reclaimed once they are half of the
+             *        array, so a re-encoding costs O(block_) amortized.
+             *
+             */
+            void set_value(const mapped_type new_mapped_value, const size_type pos);
+            void set_value(const mapped_type new_mapped_value, const key_type& key, size_type ordinal = 1) { set_value(new_mapped_value, get_pos(key, ordinal)); }
+            void clear();
+            /**
+             * @brief Uncompressed copy of the elements.
+             *
+             */
+            template<size_t delta_ = 100>
+            vectormap<key_, value_, delta_> decompress() const;
+            /** @} */
+
+            /** @name  Memory manipulation */
+            /** @{ */
+            size_type size() const { return keys_.size(); }
+            bool is_empty() const { return keys_.empty(); }
+            /**
+             * @brief Bytes used by the compressed value column, block headers and words not reclaimed yet included.
+             *
+             */
+            size_type value_bytes() const { return words_.size() * sizeof(uint64_t) + blocks_.size() * sizeof(block_header_); }
+            memory_report memory_usage() const;
+            /** @} */
+
+        private:
+            using code_type = uint64_t;
+
+            struct block_header_ {
+                code_type base;
+                size_type offset;
+                unsigned width;
+            };
+
+            std::vector<key_type> keys_;
+            std::vector<block_header_> blocks_;
+            std::vector<uint64_t> words_;
+            // Words of words_ no block uses any more, left by re-encodings.
+            size_type garbage_ = 0;
+            key_type void_key_type_ = {};
+
+            // Order preserving map of the values to unsigned codes, so the block minimum is meaningful.
+            static constexpr code_type sign_ = std::is_signed_v<mapped_type> ? code_type(1) << 63 : 0;
+            static code_type to_code_(mapped_type v) { return code_type(int64_t(v)) ^ sign_; }
+            static mapped_type from_code_(code_type c) { return mapped_type(c ^ sign_); }
+            static size_type words_for_(unsigned width) { return (block_ * width + 63) / 64; }
+
+            template<unsigned W>
+            static code_type extract_(const uint64_t* in, size_type i);
+            static code_type extract_(const uint64_t* in, size_type i, unsigned width);
+            static void deposit_(uint64_t* out, size_type i, unsigned width, code_type v);
+
+            template<unsigned W>
+            static void unpack_(const uint64_t* in, size_type first, size_type count, code_type base, mapped_type* out);
+            using unpack_fn_ = void (*)(const uint64_t*, size_type, size_type, code_type, mapped_type*);
+            template<unsigned... W>
+            static constexpr std::array<unpack_fn_, sizeof...(W)> make_kernels_(std::integer_sequence<unsigned, W...>) { return {{ &unpack_<W>... }}; }
+            static constexpr std::array<unpack_fn_, 65> kernels_ = make_kernels_(std::make_integer_sequence<unsigned, 65>());
+
+            size_type block_count_(size_type b) const { return (b + 1 < blocks_.size()) ? block_ : keys_.size() - b * block_; }
+            void encode_block_(size_type b, const code_type* codes, size_type count);
+            void reclaim_();
+    };
+
+    template<DefaultInitializableKeyable key_, std::integral value_, size_t block_>
+    compressed_vectormap<key_, value_, block_>::compressed_vectormap(const std::initializer_list<value_type>& il) {
+        keys_.reserve(il.size());
+        for (auto& elem : il) {
+            push_back(elem.first, elem.second);
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::integral value_, size_t block_>
+    template<size_t delta_, class alloc_>
+    compressed_vectormap<key_, value_, block_>::compressed_vectormap(const vectormap<key_, value_, delta_, alloc_>& map) {
+        keys_.reserve(map.size());
+        blocks_.reserve((map.size() + block_ - 1) / block_);
+
+        std::array<code_type, block_> codes;
+        for (size_type first = 0; first < map.size(); first += block_) {
+            size_type count = std::min(block_, map.size() - first);
+            for (size_type i = 0; i < count; ++i) {
+                keys_.push_back(map.data()[first + i].first);
+                codes[i] = to_code_(map.data()[first + i].second);
+            }
+            blocks_.push_back({0, words_.size(), 0});
+            encode_block_(blocks_.size() - 1, codes.data(), count);
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::integral value_, size_t block_>
+    void compressed_vectormap<key_, value_, block_>::push_back(const key_type& key, const mapped_type val) {
+        size_type pos = keys_.size();
+        code_type code = to_code_(val);
+
+        if (pos % block_ == 0) {
+            // First value of a new block: it is the base and takes no bits until the block widens.
+            blocks_.push_back({code, words_.size(), 0});
+            try {
+                keys_.push_back(key);
+            }
+            catch (...) {
+                blocks_.pop_back();
+                throw;
+            }
+            return;
+        }
+
+        keys_.push_back(key);
+        try {
+            set_value(val, pos);
+        }
+        catch (...) {
+            keys_.pop_back();
+            throw;
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::integral value_, size_t block_>
+    typename compressed_vectormap<key_, value_, block_>::mapped_type compressed_vectormap<key_, value_, block_>::get_value(const size_type pos) const {
+        if (pos >= keys_.size()) {
+            return mapped_type();
+        }
+
+        const block_header_& block = blocks_[pos / block_];
+        return from_code_(block.base + extract_(words_.data() + block.offset, pos % block_, block.width));
+    }
+
+    template<DefaultInitializableKeyable key_, std::integral value_, size_t block_>
+    typename compressed_vectormap<key_, value_, block_>::size_type compressed_vectormap<key_, value_, block_>::get_pos(const key_type& key, size_type ordinal) const {
+        if (ordinal == 0) {
+            return npos;
+        }
+        for (size_type i = 0; i < keys_.size(); ++i) {
+            if ((keys_[i] == key) && (--ordinal == 0)) {
+                return i;
+            }
+        }
+        return npos;
+    }
+
+    template<DefaultInitializableKeyable key_, std::integral value_, size_t block_>
+    typename compressed_vectormap<key_, value_, block_>::size_type compressed_vectormap<key_, value_, block_>::decode(size_type first, std::span<mapped_type> out) const {
+        if (first >= keys_.size()) {
+            return 0;
+        }
+
+        size_type total = std::min(out.size(), keys_.size() - first);
+        size_type done = 0;
+        while (done < total) {
+            size_type pos = first + done;
+            const block_header_& block = blocks_[pos / block_];
+            size_type count = std::min(block_ - pos % block_, total - done);
+            kernels_[block.width](words_.data() + block.offset, pos % block_, count, block.base, out.data() + done);
+            done += count;
+        }
+        return total;
+    }
+
+    template<DefaultInitializableKeyable key_, std::integral value_, size_t block_>
+    template<class Fn>
+        requires std::invocable<Fn&, const typename compressed_vectormap<key_, value_, block_>::key_type&, typename compressed_vectormap<key_, value_, block_>::mapped_type>
+    void compressed_vectormap<key_, value_, block_>::for_each(Fn fn) const {
+        std::array<mapped_type, block_> values;
+        for (size_type b = 0; b < blocks_.size(); ++b) {
+            size_type count = block_count_(b);
+            kernels_[blocks_[b].width](words_.data() + blocks_[b].offset, 0, count, blocks_[b].base, values.data());
+            for (size_type i = 0; i < count; ++i) {
+                fn(keys_[b * block_ + i], values[i]);
+            }
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::integral value_, size_t block_>
+    void compressed_vectormap<key_, value_, block_>::set_value(const mapped_type new_mapped_value, const size_type pos) {
+        if (pos >= keys_.size()) {
+            return;
+        }
+
+        size_type b = pos / block_;
+        block_header_& block = blocks_[b];
+        code_type code = to_code_(new_mapped_value);
+        code_type delta = code - block.base;
+
+        if ((code >= block.base) && (std::bit_width(delta) <= block.width)) {
+            deposit_(words_.data() + block.offset, pos % block_, block.width, delta);
+            return;
+        }
+
+        // The value is outside the frame of the block: decode it and encode it again with a new base and width.
+        std::array<code_type, block_> codes;
+        size_type count = block_count_(b);
+        for (size_type i = 0; i < count; ++i) {
+            codes[i] = (i == pos % block_) ? code : block.base + extract_(words_.data() + block.offset, i, block.width);
+        }
+        encode_block_(b, codes.data(), count);
+    }
+
+    template<DefaultInitializableKeyable key_, std::integral value_, size_t block_>
+    void compressed_vectormap<key_, value_, block_>::clear() {
+        keys_.clear();
+        blocks_.clear();
+        words_.clear();
+        garbage_ = 0;
+    }
+
+    template<DefaultInitializableKeyable key_, std::integral value_, size_t block_>
+    template<size_t delta_>
+    vectormap<key_, value_, delta_> compressed_vectormap<key_, value_, block_>::decompress() const {
+        vectormap<key_, value_, delta_> out;
+        out.reserve(keys_.size());
+        for_each([&](const key_type& key, mapped_type val) { out.emplace_back(key, val); });
+        return out;
+    }
+
+    template<DefaultInitializableKeyable key_, std::integral value_, size_t block_>
+    memory_report compressed_vectormap<key_, value_, block_>::memory_usage() const {
+        memory_report report;
+        report.object_bytes = sizeof(*this);
+        report.buffer_bytes = keys_.capacity() * sizeof(key_type) + blocks_.capacity() * sizeof(block_header_) + words_.capacity() * sizeof(uint64_t);
+        report.used_bytes = keys_.size() * sizeof(key_type) + value_bytes();
+
+        if constexpr (!std::is_arithmetic_v<key_type>) {
+            heap_usage<key_type> key_usage;
+            for (const key_type& key : keys_) {
+                report.heap_bytes += key_usage(key);
+            }
+        }
+
+        return report;
+    }
+
+    template<DefaultInitializableKeyable key_, std::integral value_, size_t block_>
+    template<unsigned W>
+    typename compressed_vectormap<key_, value_, block_>::code_type compressed_vectormap<key_, value_, block_>::extract_(const uint64_t* in, size_type i) {
+        if constexpr (W == 0) {
+            return 0;
+        }
+        else {
+            size_type bit = i * W;
+            unsigned shift = unsigned(bit & 63);
+            code_type v = in[bit >> 6] >> shift;
+            if constexpr (W < 64) {
+                if (shift + W > 64) {
+                    v |= in[(bit >> 6) + 1] << (64 - shift);
+                }
+                return v & ((code_type(1) << W) - 1);
+            }
+            else {
+                return v;
+            }
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::integral value_, size_t block_>
+    typename compressed_vectormap<key_, value_, block_>::code_type compressed_vectormap<key_, value_, block_>::extract_(const uint64_t* in, size_type i, unsigned width) {
+        if (width == 0) {
+            return 0;
+        }
+
+        size_type bit = i * width;
+        unsigned shift = unsigned(bit & 63);
+        code_type v = in[bit >> 6] >> shift;
+        if (shift + width > 64) {
+            v |= in[(bit >> 6) + 1] << (64 - shift);
+        }
+        return (width == 64) ? v : v & ((code_type(1) << width) - 1);
+    }
+
+    template<DefaultInitializableKeyable key_, std::integral value_, size_t block_>
+    void compressed_vectormap<key_, value_, block_>::deposit_(uint64_t* out, size_type i, unsigned width, code_type v) {
+        if (width == 0) {
+            return;
+        }
+
+        size_type bit = i * width;
+        unsigned shift = unsigned(bit & 63);
+        code_type mask = (width == 64) ? ~code_type(0) : (code_type(1) << width) - 1;
+        out[bit >> 6] = (out[bit >> 6] & ~(mask << shift)) | (v << shift);
+        if (shift + width > 64) {
+            unsigned high = 64 - shift;
+            out[(bit >> 6) + 1] = (out[(bit >> 6) + 1] & ~(mask >> high)) | (v >> high);
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::integral value_, size_t block_>
+    template<unsigned W>
+    void compressed_vectormap<key_, value_, block_>::unpack_(const uint64_t* in, size_type first, size_type count, code_type base, mapped_type* out) {
+        // With the width known at compile time the shifts and masks are constants, which lets the
+        // compiler unroll and vectorize the loop.
+        for (size_type i = 0; i < count; ++i) {
+            out[i] = from_code_(base + extract_<W>(in, first + i));
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::integral value_, size_t block_>
+    void compressed_vectormap<key_, value_, block_>::encode_block_(size_type b, const code_type* codes, size_type count) {
+        code_type low = codes[0];
+        code_type high = codes[0];
+        for (size_type i = 1; i < count; ++i) {
+            low = std::min(low, codes[i]);
+            high = std::max(high, codes[i]);
+        }
+        unsigned width = unsigned(std::bit_width(high - low));
+
+        // Every block keeps room for block_ values, so the tail block can take appends in place.
+        block_header_& block = blocks_[b];
+        size_type old_words = words_for_(block.width);
+        size_type new_words = words_for_(width);
+        if (block.offset + old_words == words_.size()) {
+            // Last block of the array: it grows or shrinks in place.
+            words_.resize(block.offset + new_words);
+        }
+        else if (new_words > old_words) {
+            // Moving the block to the end keeps the others where they are.
+            words_.resize(words_.size() + new_words);
+            garbage_ += old_words;
+            block.offset = words_.size() - new_words;
+        }
+        else {
+            garbage_ += old_words - new_words;
+        }
+
+        std::fill(words_.begin() + block.offset, words_.begin() + block.offset + new_words, 0);
+        block.base = low;
+        block.width = width;
+        for (size_type i = 0; i < count; ++i) {
+            deposit_(words_.data() + block.offset, i, width, codes[i] - low);
+        }
+
+        if (garbage_ * 2 > words_.size()) {
+            reclaim_();
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::integral value_, size_t block_>
+    void compressed_vectormap<key_, value_, block_>::reclaim_() {
+        // Packs the blocks again in their order. It runs after at least words_.size() / 2 words were
+        // left behind, so its cost is spread over the re-encodings that left them.
+        std::vector<uint64_t> packed;
+        packed.reserve(words_.size() - garbage_);
+        for (block_header_& block : blocks_) {
+            size_type offset = packed.size();
+            packed.insert(packed.end(), words_.begin() + block.offset, words_.begin() + block.offset + words_for_(block.width));
+            block.offset = offset;
+        }
+        words_ = std::move(packed);
+        garbage_ = 0;
+    }
+}
+#endif
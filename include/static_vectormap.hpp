@@ -0,0 +1,143 @@
+#ifndef __STATICVECTORMAP_H__
+#define __STATICVECTORMAP_H__
+
+#include "vectormap_concepts.hpp"
+
+#include <array>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+#include <concepts>
+#include <limits>
+
+namespace com {
+    /**
+     * @brief Immutable vectormap with a fixed number of elements stored in a std::array.\n
+     *        It can be built and queried in constant expressions. When the keys are totally ordered
+     *        a sorted index of the positions is built at construction, so key lookups are a
+     *        branchless binary search instead of a linear scan.
+     *
+     * @tparam key_   Type of the key.
+     * @tparam value_ Type of the value.
+     * @tparam size_  Number of elements.
+     */
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t size_>
+    class static_vectormap
+    {
+        public:
+            /** @cond */
+            using key_type = key_;
+            using mapped_type = value_;
+            using value_type = std::pair<const key_type, mapped_type>;
+            using reference = const value_type&;
+            using const_reference = const value_type&;
+            using pointer = const value_type*;
+            using const_pointer = const value_type*;
+            using iterator = const value_type*;
+            using const_iterator = const value_type*;
+            using size_type = size_t;
+
+            static constexpr size_type npos = std::numeric_limits<size_type>::max();
+            static constexpr bool indexed = std::totally_ordered<key_type>;
+            /** @endcond */
+
+            /** @name Constructors */
+            /** @{ */
+
+            /**
+             * @brief Construct a new static_vectormap object from a list.
+             *
+             * @param il List with exactly size_ elements. Shorter lists are rejected instead of being
+             *           padded with value-initialized elements.
+             */
+            template<size_type n_>
+                requires (n_ == size_)
+            constexpr static_vectormap(const value_type (&il)[n_]) : data_(make_data_(il, std::make_index_sequence<size_>())) {
+                if constexpr (indexed) {
+                    for (size_type i = 0; i < size_; ++i) {
+                        index_[i] = i;
+                    }
+                    std::sort(index_.begin(), index_.end(), [this](size_type a, size_type b) {
+                        return (data_[a].first < data_[b].first) || (!(data_[b].first < data_[a].first) && (a < b));
+                    });
+                }
+            }
+            /** @} */
+
+            /** @name Element access */
+            /** @{ */
+            constexpr const_iterator get(const size_type pos) const { return pos < size_ ? data_.data() + pos : end(); }
+            constexpr const_iterator get(const key_type& key, size_type ordinal = 1) const { return get(get_pos(key, ordinal)); }
+            constexpr const mapped_type& get_value(const size_type pos) const { return pos < size_ ? data_[pos].second : void_mapped_type_; }
+            constexpr const mapped_type& get_value(const key_type& key, size_type ordinal = 1) const { return get_value(get_pos(key, ordinal)); }
+            constexpr const key_type& get_key(const size_type pos) const { return pos < size_ ? data_[pos].first : void_key_type_; }
+            constexpr size_type get_pos(const key_type& key, size_type ordinal = 1) const;
+            constexpr bool contains(const key_type& key) const { return get_pos(key) != npos; }
+            constexpr const_pointer data() const { return data_.data(); }
+            /** @} */
+
+            /** @name  Memory manipulation */
+            /** @{ */
+            constexpr size_type size() const { return size_; }
+            constexpr size_type capacity() const { return size_; }
+            constexpr bool is_empty() const { return size_ == 0; }
+            /** @} */
+
+            /** @name  Iterators */
+            /** @{ */
+            constexpr const_iterator begin() const { return data_.data(); }
+            constexpr const_iterator end() const { return data_.data() + size_; }
+            constexpr const_iterator cbegin() const { return begin(); }
+            constexpr const_iterator cend() const { return end(); }
+            /** @} */
+
+        private:
+            std::array<value_type, size_> data_;
+            std::array<size_type, indexed ? size_ : 0> index_ = {};
+            mapped_type void_mapped_type_ = {};
+            key_type void_key_type_ = {};
+
+            template<size_type... Is>
+            static constexpr std::array<value_type, size_> make_data_(const value_type (&il)[size_], std::index_sequence<Is...>) {
+                return {{ il[Is]... }};
+            }
+    };
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t size_>
+    constexpr typename static_vectormap<key_, value_, size_>::size_type static_vectormap<key_, value_, size_>::get_pos(const key_type& key, size_type ordinal) const {
+        if (ordinal == 0) {
+            return npos;
+        }
+
+        if constexpr (indexed) {
+            if constexpr (size_ == 0) {
+                return npos;
+            }
+            else {
+                // Branchless lower bound: the loop always runs log2(size_) times.
+                size_type base = 0;
+                size_type length = size_;
+                while (length > 1) {
+                    size_type half = length / 2;
+                    base = (data_[index_[base + half]].first < key) ? base + half : base;
+                    length -= half;
+                }
+                if (data_[index_[base]].first < key) {
+                    ++base;
+                }
+
+                base += ordinal - 1;
+                return ((base < size_) && (data_[index_[base]].first == key)) ? index_[base] : npos;
+            }
+        }
+        else {
+            for (size_type i = 0; i < size_; ++i) {
+                if ((data_[i].first == key) && (--ordinal == 0)) {
+                    return i;
+                }
+            }
+            return npos;
+        }
+    }
+}
+#endif
@@ -10,6 +10,27 @@
 #include <type_traits>
 #include <limits>
 #include <concepts>
+#include <compare>
+#include <span>
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <unordered_map>
+#include <thread>
+#include <exception>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <system_error>
+#include <stdexcept>
+#include <new>
+#include <cstdint>
+
+#include "vectormap_concepts.hpp"
+
+#if !defined(VECTORMAP_MEMORY_REGISTRY)
+#define VECTORMAP_MEMORY_REGISTRY 0
+#endif
 
 /**
  * @brief General namespace
@@ -17,10 +38,206 @@
  */
 namespace com {
     template<class T>
-    concept Keyable = (requires(T a_, T b_) {a_ == b_;}) && (!std::is_integral<T>::value);
+    concept Hashable = requires(const T& a_) { { std::hash<T>{}(a_) } -> std::convertible_to<size_t>; };
+
+    /**
+     * @brief Which element survives when vectormap::dedupe_keys() collapses duplicated keys.
+     * 
+     */
+    enum class dedupe_policy { keep_first, keep_last };
+
+    /**
+     * @brief What vectormap::merge() does with a key present in both vectormaps.
+     * 
+     */
+    enum class merge_policy { keep_ours, keep_theirs, keep_both };
+
+    /**
+     * @brief Kind of an entry of the edit script returned by vectormap::diff().
+     * 
+     */
+    enum class edit_kind { removed, added, changed, moved };
 
+    /**
+     * @brief Customization point with the heap bytes owned by an object, not counting sizeof(T).\n
+     *        Specialize it for key or value types that own memory so vectormap::memory_usage()
+     *        can report them.
+     * 
+     */
     template<class T>
-    concept DefaultInitializableKeyable = Keyable<T> && std::default_initializable<T>;
+    struct heap_usage {
+        size_t operator()(const T&) const { return 0; }
+    };
+
+    template<class C, class Tr, class A>
+    struct heap_usage<std::basic_string<C, Tr, A>> {
+        size_t operator()(const std::basic_string<C, Tr, A>& s) const {
+            // Strings stored in the small string buffer own no heap memory.
+            const char* p = reinterpret_cast<const char*>(s.data());
+            const char* self = reinterpret_cast<const char*>(&s);
+            return ((p >= self) && (p < self + sizeof(s))) ? 0 : (s.capacity() + 1) * sizeof(C);
+        }
+    };
+
+    template<class T, class A>
+    struct heap_usage<std::vector<T, A>> {
+        size_t operator()(const std::vector<T, A>& v) const {
+            size_t bytes = v.capacity() * sizeof(T);
+            for (const T& elem : v) {
+                bytes += heap_usage<T>{}(elem);
+            }
+            return bytes;
+        }
+    };
+
+    template<class A, class B>
+    struct heap_usage<std::pair<A, B>> {
+        size_t operator()(const std::pair<A, B>& p) const { return heap_usage<std::remove_cv_t<A>>{}(p.first) + heap_usage<std::remove_cv_t<B>>{}(p.second); }
+    };
+
+    /**
+     * @brief Memory held by a vectormap, as returned by vectormap::memory_usage().
+     * 
+     */
+    struct memory_report {
+        /** sizeof the vectormap object itself. */
+        size_t object_bytes = 0;
+        /** Bytes of the element buffer: capacity() elements. */
+        size_t buffer_bytes = 0;
+        /** Bytes of the buffer holding live elements: size() elements. */
+        size_t used_bytes = 0;
+        /** Heap bytes owned by the keys and values, as reported by heap_usage, and by the handle tables and the hot key cache. */
+        size_t heap_bytes = 0;
+
+        size_t total() const { return object_bytes + buffer_bytes + heap_bytes; }
+    };
+
+    /**
+     * @brief Counters of the hot key cache, as returned by vectormap::hot_cache_stats().
+     * 
+     */
+    struct hot_cache_stats {
+        /** Key lookups answered from the cache. */
+        size_t hits = 0;
+        /** Key lookups that had to scan from the beginning. */
+        size_t misses = 0;
+    };
+
+    /**
+     * @brief Process-wide count of the live vectormaps and of the bytes of their element buffers.\n
+     *        Disabled unless VECTORMAP_MEMORY_REGISTRY is defined to 1 in every translation unit,
+     *        as it adds atomic operations on shared counters to every construction and allocation.
+     *        The counters stay at 0 when it is disabled.
+     * 
+     */
+    class memory_registry {
+        public:
+            static constexpr bool enabled = VECTORMAP_MEMORY_REGISTRY;
+
+            static memory_registry& instance() {
+                static memory_registry registry;
+                return registry;
+            }
+
+            size_t live_maps() const { return live_maps_.load(std::memory_order_relaxed); }
+            size_t buffer_bytes() const { return buffer_bytes_.load(std::memory_order_relaxed); }
+            size_t peak_buffer_bytes() const { return peak_buffer_bytes_.load(std::memory_order_relaxed); }
+
+            /** @cond */
+            static void attach() {
+                if constexpr (enabled) {
+                    instance().live_maps_.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            static void detach() {
+                if constexpr (enabled) {
+                    instance().live_maps_.fetch_sub(1, std::memory_order_relaxed);
+                }
+            }
+            static void allocated(size_t bytes) {
+                if constexpr (enabled) {
+                    memory_registry& registry = instance();
+                    size_t now = registry.buffer_bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+                    size_t peak = registry.peak_buffer_bytes_.load(std::memory_order_relaxed);
+                    while ((now > peak) && !registry.peak_buffer_bytes_.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {}
+                }
+            }
+            static void deallocated(size_t bytes) {
+                if constexpr (enabled) {
+                    instance().buffer_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+                }
+            }
+            /** @endcond */
+
+        private:
+            memory_registry() = default;
+
+            std::atomic<size_t> live_maps_ = 0;
+            std::atomic<size_t> buffer_bytes_ = 0;
+            std::atomic<size_t> peak_buffer_bytes_ = 0;
+    };
+
+    /**
+     * @brief Tag that selects the multithreaded overload of an operation.
+     * 
+     */
+    struct parallel_t {
+        /** Minimum number of elements handled by every thread. */
+        static constexpr size_t grain = 1 << 14;
+    };
+    inline constexpr parallel_t parallel{};
+
+    /** @cond */
+    namespace detail {
+        /**
+         * @brief Splits [0, n) in chunks of at least grain elements and runs fn(begin, end) on
+         *        each of them in its own thread, using at most workers threads (0: the hardware ones).
+         *        The first exception thrown by a chunk is rethrown.
+         * 
+         */
+        template<class Fn>
+        void parallel_for(size_t n, size_t grain, Fn&& fn, size_t workers = 0) {
+            if (workers == 0) {
+                workers = std::max<size_t>(1, std::thread::hardware_concurrency());
+            }
+            size_t chunks = std::clamp<size_t>(n / std::max<size_t>(grain, 1), 1, workers);
+            if (chunks == 1) {
+                fn(size_t(0), n);
+                return;
+            }
+
+            // Allocating errors is the only failure before any chunk runs. Past it only fn throws:
+            // a chunk whose thread cannot be started runs on the calling thread.
+            std::vector<std::exception_ptr> errors(chunks);
+            auto run = [&](size_t c) {
+                try {
+                    fn((n * c) / chunks, (n * (c + 1)) / chunks);
+                }
+                catch (...) {
+                    errors[c] = std::current_exception();
+                }
+            };
+            {
+                std::vector<std::jthread> threads;
+                for (size_t c = 1; c < chunks; ++c) {
+                    try {
+                        threads.emplace_back(run, c);
+                    }
+                    catch (...) {
+                        run(c);
+                    }
+                }
+                run(0);
+            }
+
+            for (auto& error : errors) {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+            }
+        }
+    }
+    /** @endcond */
 
     /**
      * @brief Container that stores pairs of key / value respecting the insert order.
@@ -29,19 +246,23 @@ namespace com {
      * @tparam key_   Type of the key.
      * @tparam value_ Type of the value.
      * @tparam delta_ Number of new elements to allocate every time the container growths.
+     * @tparam alloc_ Allocator of std::pair<const key_, value_>.
      */
-    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_ = 100>
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_ = 100, class alloc_ = std::allocator<std::pair<const key_, value_>>>
     class vectormap
     {
         public:
             class Iterator;
             class ConstIterator;
 
+            static_assert(std::is_same_v<typename std::allocator_traits<alloc_>::value_type, std::pair<const key_, value_>>,
+                          "alloc_ must allocate std::pair<const key_, value_>");
+
             /** @cond */
             using key_type = key_;
             using mapped_type = value_;
             using value_type = std::pair<const key_type, mapped_type>;
-            using allocator_type = std::allocator<value_type>;
+            using allocator_type = alloc_;
             using allocator_traits = std::allocator_traits<allocator_type>;
             using reference = value_type&;
             using const_reference = const value_type&;
@@ -55,13 +276,17 @@ namespace com {
             using iterator_pos = std::pair<iterator, size_type>;
             
             static constexpr size_type npos = std::numeric_limits<size_type>::max();
+            /** Number of keys lookup_batch() resolves per pass over the elements. */
+            static constexpr size_type lookup_block = 512;
 
             /** @endcond */
 
             class Iterator {
                 public:
-                    using iterator_category = std::bidirectional_iterator_tag;
+                    using iterator_category = std::random_access_iterator_tag;
+                    using iterator_concept = std::contiguous_iterator_tag;
                     using value_type = typename vectormap::value_type;
+                    using element_type = value_type;
                     using difference_type = std::ptrdiff_t;
                     using pointer = value_type*;
                     using reference = value_type&;
@@ -69,14 +294,19 @@ namespace com {
                     Iterator(pointer ptr = nullptr) : ptr_(ptr) {}
                     reference operator*() const { return *ptr_; }
                     pointer operator->() const { return ptr_; }
-                    iterator operator+(int other) { return iterator(ptr_ + other); }
-                    iterator operator-(int other) { return iterator(ptr_ - other); }
+                    reference operator[](difference_type n) const { return ptr_[n]; }
+                    iterator operator+(difference_type other) const { return iterator(ptr_ + other); }
+                    iterator operator-(difference_type other) const { return iterator(ptr_ - other); }
+                    difference_type operator-(const iterator& other) const { return ptr_ - other.ptr_; }
+                    friend iterator operator+(difference_type n, const iterator& it) { return it + n; }
+                    iterator& operator+=(difference_type n) { ptr_ += n; return *this; }
+                    iterator& operator-=(difference_type n) { ptr_ -= n; return *this; }
                     iterator& operator++() { ++ptr_; return *this; }
                     iterator operator++(int) { iterator tmp = *this; ++ptr_; return tmp; }
                     iterator& operator--() { --ptr_; return *this; }
                     iterator operator--(int) { iterator tmp = *this; --ptr_; return tmp; }
                     bool operator==(const iterator& other) const { return ptr_ == other.ptr_; }
-                    bool operator!=(const iterator& other) const { return ptr_ != other.ptr_; }
+                    auto operator<=>(const iterator& other) const { return ptr_ <=> other.ptr_; }
 
                     operator ConstIterator() const { return static_cast<const_pointer>(ptr_); }
 
@@ -87,8 +317,10 @@ namespace com {
 
             class ConstIterator {
                 public:
-                    using iterator_category = std::bidirectional_iterator_tag;
-                    using value_type = const vectormap::value_type;
+                    using iterator_category = std::random_access_iterator_tag;
+                    using iterator_concept = std::contiguous_iterator_tag;
+                    using value_type = typename vectormap::value_type;
+                    using element_type = const value_type;
                     using difference_type = std::ptrdiff_t;
                     using pointer = const value_type*;
                     using reference = const value_type&;
@@ -96,20 +328,81 @@ namespace com {
                     ConstIterator(pointer ptr = nullptr) : ptr_(ptr) {}
                     reference operator*() const { return *ptr_; }
                     pointer operator->() const { return ptr_; }
-                    ConstIterator operator+(int other) { return const_iterator(ptr_ + other); }
-                    ConstIterator operator-(int other) { return const_iterator(ptr_ - other); }
+                    reference operator[](difference_type n) const { return ptr_[n]; }
+                    ConstIterator operator+(difference_type other) const { return const_iterator(ptr_ + other); }
+                    ConstIterator operator-(difference_type other) const { return const_iterator(ptr_ - other); }
+                    difference_type operator-(const ConstIterator& other) const { return ptr_ - other.ptr_; }
+                    friend ConstIterator operator+(difference_type n, const ConstIterator& it) { return it + n; }
+                    ConstIterator& operator+=(difference_type n) { ptr_ += n; return *this; }
+                    ConstIterator& operator-=(difference_type n) { ptr_ -= n; return *this; }
                     ConstIterator& operator++() { ++ptr_; return *this; }
                     ConstIterator operator++(int) { ConstIterator tmp = *this; ++ptr_; return tmp; }
                     ConstIterator& operator--() { --ptr_; return *this; }
                     ConstIterator operator--(int) { ConstIterator tmp = *this; --ptr_; return tmp; }
                     bool operator==(const ConstIterator& other) const { return ptr_ == other.ptr_; }
-                    bool operator!=(const ConstIterator& other) const { return ptr_ != other.ptr_; }
+                    auto operator<=>(const ConstIterator& other) const { return ptr_ <=> other.ptr_; }
 
                 private:
                     pointer ptr_;
             };        
             
             
+            /**
+             * @brief Log of positional edits that are applied all together.\n
+             *        Positions passed to insert() and erase() refer to the pending state, as if every
+             *        previous edit of the batch had already been applied, and get() reads that state.
+             *        The pending state is a list of runs, at most 2k + 1 for k edits. Every edit locates its
+             *        run with a linear walk and may insert a run, so recording k scattered edits costs O(k²);
+             *        edits that extend the previous run (e.g. consecutive insertions) add no run.
+             *        commit() then applies them to the vectormap in a single O(N + k) pass.\n
+             *        The vectormap must not be modified directly while a batch has pending edits.
+             * 
+             */
+            class batch {
+                public:
+                    explicit batch(vectormap& map) : map_(map) { discard(); }
+
+                    bool insert(const value_type& val, const size_type pos);
+                    bool insert(const key_type& key, const mapped_type& val, const size_type pos) { return insert(std::make_pair<>(key, val), pos); }
+                    bool push_back(const value_type& val) { return insert(val, size_); }
+                    bool erase(const size_type pos);
+                    /**
+                     * @brief Element at a position of the pending state.
+                     * 
+                     * @param pos       Position.
+                     * @return pointer  Pointer to the element or nullptr if pos is out of range.
+                     *                  It is invalidated by the next edit.
+                     */
+                    pointer get(const size_type pos);
+                    size_type size() const { return size_; }
+                    bool is_pending() const { return (runs_.size() != 1) || !runs_[0].original || (runs_[0].count != map_.size_); }
+                    /**
+                     * @brief Applies the pending edits to the vectormap and starts a new empty batch.
+                     * 
+                     */
+                    void commit();
+                    /**
+                     * @brief Drops the pending edits.
+                     * 
+                     */
+                    void discard();
+
+                private:
+                    // Consecutive elements of the pending state: a range of the vectormap or of values_.
+                    struct run_ {
+                        bool original;
+                        size_type first;
+                        size_type count;
+                    };
+
+                    vectormap& map_;
+                    std::vector<run_> runs_;
+                    std::vector<value_type> values_;
+                    size_type size_ = 0;
+
+                    std::pair<size_type, size_type> locate_(const size_type pos) const;
+            };
+
             /** @name Constructors */
             /** @{ */
 
@@ -117,7 +410,7 @@ namespace com {
              * @brief Default constructor.
              * 
              */
-            vectormap() : capacity_(0), size_(0), data_(nullptr) {};
+            vectormap() : capacity_(0), size_(0), data_(nullptr) { memory_registry::attach(); };
 
             /**
              * @brief Construct a new vectormap object from a list.
@@ -149,10 +442,21 @@ namespace com {
             /** @name Element insertion
              */
             /** @{ */
+            /**
+             * @brief Inserts an element at a position.\n
+             *        Growing builds the result in a new buffer and leaves the vectormap unchanged on failure.
+             *        Within the capacity the following elements are shifted in place, which has the same
+             *        guarantee when value_type is nothrow movable; otherwise, as with std::vector::insert,
+             *        the elements after pos may be lost if moving one throws.
+             * 
+             * @param val        Element to insert. It may be an element of the vectormap.
+             * @param pos        Position of the new element.
+             * @return iterator  Iterator pointing to the added element.
+             */
             iterator insert(const value_type& val, const size_type pos);
             iterator insert(const key_type& key, const mapped_type& val, const size_type pos) { return insert(std::make_pair<>(key, val), pos); }
             iterator insert(const std::initializer_list<value_type>& il, const size_type pos);
-            iterator insert(const vectormap<key_type, mapped_type, delta_>& map, const size_type pos);
+            iterator insert(const vectormap& map, const size_type pos);
             /**
              * @brief Adds an element at the end of the vectormap.
              * 
@@ -169,16 +473,41 @@ namespace com {
              */
             iterator push_back(const key_type& key, const mapped_type& val) { return insert(key, val, size_); }
             iterator push_back(const std::initializer_list<value_type>& il) { return insert(il, size_); }
-            iterator push_back(const vectormap<key_type, mapped_type, delta_>& map) { return insert(map, size_); }
+            iterator push_back(const vectormap& map) { return insert(map, size_); }
             iterator push_front(const value_type& val) { return insert(val, 0); }
             iterator push_front(const key_type& key, const mapped_type& val) { return insert(key, val, 0); }
             iterator push_front(const std::initializer_list<value_type>& il) { return insert(il, 0); }
-            iterator push_front(const vectormap<key_type, mapped_type, delta_>& map) { return insert(map, 0); }
+            iterator push_front(const vectormap& map) { return insert(map, 0); }
+            /**
+             * @brief Inserts an element reporting failures as an error code instead of an exception.\n
+             *        Exceptions thrown by the constructors of key_type or mapped_type still propagate.
+             *        On failure the vectormap is left unchanged.
+             * 
+             * @param val               Element to insert.
+             * @param pos               Position of the new element.
+             * @return std::error_code  Empty on success, std::errc::result_out_of_range if pos > size(),
+             *                          std::errc::not_enough_memory or std::errc::value_too_large if growing fails.
+             */
+            std::error_code try_insert(const value_type& val, const size_type pos);
+            std::error_code try_push_back(const value_type& val) { return try_insert(val, size_); }
+            /**
+             * @brief Constructs an element in place at a position.
+             * 
+             * @param pos        Position of the new element.
+             * @param args       Arguments forwarded to the constructor of value_type.
+             * @return iterator  Iterator pointing to the added element.
+             */
+            template<class... Args>
+            iterator emplace(const size_type pos, Args&&... args);
+            template<class... Args>
+            iterator emplace_back(Args&&... args) { return emplace(size_, std::forward<Args>(args)...); }
             /** @} */
 
             /** @name Element access */
             /** @{ */
             iterator get(const size_type pos) { return pos < size_ ? iterator(&data_[pos]) : end(); }
+            // With set_hot_cache() enabled the key lookups below update the cache and are not safe to
+            // run concurrently on a shared vectormap.
             std::vector<iterator_pos> get(const key_type& key, size_type ordinal = 1, size_type number = 1);
             std::vector<iterator_pos> get_all(const key_type& key);      
             mapped_type& get_value(const size_type& pos) { return pos < size_ ? data_[pos].second : void_mapped_type_; }
@@ -187,39 +516,271 @@ namespace com {
             const key_type& get_key(const size_type& pos) { return pos < size_ ? data_[pos].first : void_key_type_; }
             std::vector<size_type> get_pos(const key_type& key, size_type ordinal = 1, size_type number = 1);
             std::vector<size_type> get_all_pos(const key_type& key);
+            /**
+             * @brief Position of the first element of every key in one pass over the elements.\n
+             *        Up to lookup_block keys are hashed into a table on the stack and all of them are
+             *        tested against every element, so K keys cost O(N * ceil(K / lookup_block) + K)
+             *        instead of the O(N * K) of calling get() for each. Nothing is allocated.
+             * 
+             * @param keys      Keys to look up. Repeated keys are allowed.
+             * @param out       Receives the position of each key, or npos if it is not present.
+             *                  Only the first min(keys.size(), out.size()) keys are resolved.
+             * @return size_type  Number of keys found.
+             */
+            size_type lookup_batch(std::span<const key_type> keys, std::span<size_type> out) const requires Hashable<key_type>;
+            /**
+             * @brief Value of the first element of every key in one pass over the elements. See lookup_batch().
+             * 
+             * @param keys      Keys to look up. Repeated keys are allowed.
+             * @param out       Receives a pointer to the value of each key, or nullptr if it is not present.
+             * @return size_type  Number of keys found.
+             */
+            size_type lookup_batch(std::span<const key_type> keys, std::span<mapped_type*> out) requires Hashable<key_type>;
             pointer data() { return data_; }
+            const_pointer data() const { return data_; }
+            /**
+             * @brief View of the stored elements as a contiguous span.
+             * 
+             * @return std::span<value_type>  Span over the elements [0, size()).
+             */
+            std::span<value_type> span() { return std::span<value_type>(data_, size_); }
+            std::span<const value_type> span() const { return std::span<const value_type>(data_, size_); }
             /** @} */
 
             /** @name  Element modification */
             /** @{ */
-            void set(const value_type& new_value, const size_type pos) { data_[pos] = new_value; }
-            void set(const value_type& new_value, const key_type& key, size_type ordinal = 1) { get(key, ordinal).first = new_value; }
+            void set(const value_type& new_value, const size_type pos);
+            void set(const value_type& new_value, const key_type& key, size_type ordinal = 1) { for (size_type pos : get_pos(key, ordinal)) set(new_value, pos); }
             void set_value(const mapped_type& new_mapped_value, const size_type pos) { data_[pos].second = new_mapped_value; }
-            void set_value(const mapped_type& new_mapped_value, const key_type& key, size_type ordinal = 1){ get_value(key, ordinal) = new_mapped_value; }
-            void set_key(const key_type& new_key, const size_type pos) { data_[pos].first = new_key; }
-            void set_key(const key_type& new_key, const key_type& key, size_type ordinal = 1) { get(key, ordinal).first->first = new_key; }
+            void set_value(const mapped_type& new_mapped_value, const key_type& key, size_type ordinal = 1) { for (size_type pos : get_pos(key, ordinal)) set_value(new_mapped_value, pos); }
+            void set_key(const key_type& new_key, const size_type pos) { set(value_type(new_key, data_[pos].second), pos); }
+            void set_key(const key_type& new_key, const key_type& key, size_type ordinal = 1) { for (size_type pos : get_pos(key, ordinal)) set_key(new_key, pos); }
             /** @} */
 
             /** @name  Element management */
             /** @{ */
             void clear();
             void erase(const size_type pos);
-            void erase(const key_type& key) { erase(get(key).second);  }
+            void erase(const key_type& key) { for (size_type pos : get_pos(key)) erase(pos); }
             void erase(const std::initializer_list<size_type>& il);
             void erase_all(const key_type& key);
             void move(const size_type from, const size_type to);
             void swap(const size_type from, const size_type to);
             void swap(vectormap& a, vectormap& b);
             /** @} */
+
+            /** @name  Element ordering */
+            /** @{ */
+            /**
+             * @brief Stable sort of the elements by a projection of them.
+             * 
+             * @param proj  Projection applied to every value_type before comparing.
+             * @param comp  Strict weak ordering over the projected values.
+             */
+            template<class Proj = std::identity, class Compare = std::ranges::less>
+            void sort_by(Proj proj = {}, Compare comp = {});
+            /**
+             * @brief Stable sort of the elements by a projection of them, spread over the hardware threads.\n
+             *        Maps smaller than parallel_t::grain are sorted serially.
+             * 
+             * @param proj  Projection applied to every value_type before comparing.
+             * @param comp  Strict weak ordering over the projected values.
+             */
+            template<class Proj = std::identity, class Compare = std::ranges::less>
+            void sort_by(parallel_t, Proj proj = {}, Compare comp = {});
+            void stable_sort_by_key() requires std::totally_ordered<key_type> { sort_by(&value_type::first); }
+            void stable_sort_by_key(parallel_t) requires std::totally_ordered<key_type> { sort_by(parallel, &value_type::first); }
+            void stable_sort_by_value() requires std::totally_ordered<mapped_type> { sort_by(&value_type::second); }
+            /**
+             * @brief Removes the elements with a repeated key, keeping one element per key.
+             * 
+             * @param policy  Whether the first or the last element of every key survives.
+             */
+            void dedupe_keys(dedupe_policy policy = dedupe_policy::keep_first);
+            /**
+             * @brief Removes the elements with a repeated key, merging their values into the first one.
+             * 
+             * @param merge_fn  Called as merge_fn(kept_value, std::move(duplicated_value)) in insertion order.
+             */
+            template<class Merge>
+                requires std::invocable<Merge&, mapped_type&, mapped_type&&>
+            void dedupe_keys(Merge merge_fn);
+            /**
+             * @brief Makes the elements with equal keys adjacent.\n
+             *        Groups follow the order in which their key is first seen and
+             *        elements keep their relative order inside every group.
+             * 
+             */
+            void group_by_key();
+            /** @} */
+
+            /** @name  Set operations */
+            /** @{ */
+            /**
+             * @brief Entry of an edit script.\n
+             *        from is a position in the original vectormap, to a position in the target one.
+             * 
+             */
+            struct edit {
+                edit_kind kind;
+                key_type key;
+                mapped_type value;
+                size_type from = npos;
+                size_type to = npos;
+            };
+            using patch = std::vector<edit>;
+
+            /**
+             * @brief Edit script that turns a into b.\n
+             *        The n-th element of a key in a is matched with the n-th element of the same key in b.
+             *        Removed entries come first, in the order of a, followed by the added, moved and
+             *        changed entries in the order of b. Matched elements that keep their relative order
+             *        (a longest increasing subsequence) are not reported as moved.
+             * 
+             * @param a       Original vectormap.
+             * @param b       Target vectormap.
+             * @return patch  Edit script to be used with apply().
+             */
+            static patch diff(const vectormap& a, const vectormap& b) requires Hashable<key_type> && std::equality_comparable<mapped_type>;
+            /**
+             * @brief Applies an edit script produced by diff() in a single compaction pass.
+             * 
+             * @param p       Edit script.
+             * @return true   The script was applied.
+             * @return false  The script does not fit this vectormap, which is left untouched.
+             */
+            bool apply(const patch& p);
+            /**
+             * @brief Merges other into this vectormap.\n
+             *        Keys not present yet are appended in the order of other.
+             * 
+             * @param other   Vectormap to merge.
+             * @param policy  What to do with the keys present in both vectormaps.
+             */
+            void merge(const vectormap& other, merge_policy policy = merge_policy::keep_ours) requires Hashable<key_type>;
+            /**
+             * @brief Merges other into this vectormap resolving every shared key with a function.
+             * 
+             * @param other     Vectormap to merge.
+             * @param merge_fn  Called as merge_fn(our_value, their_value) for every key present in both.
+             */
+            template<class Merge>
+                requires Hashable<key_> && std::invocable<Merge&, mapped_type&, const mapped_type&>
+            void merge(const vectormap& other, Merge merge_fn);
+            /**
+             * @brief Removes the elements whose key is not present in other.
+             * 
+             * @param other  Vectormap with the keys to keep.
+             */
+            void intersect(const vectormap& other) requires Hashable<key_type>;
+            /** @} */
+
+            /** @name  Stable handles */
+            /** @{ */
+            /**
+             * @brief Generational reference to an element. It keeps resolving to the element across
+             *        insertions, erasures, reorderings and reallocations, and becomes stale once the
+             *        element is erased. Copies of the vectormap resolve the same handles.
+             * 
+             */
+            struct handle {
+                uint32_t slot = std::numeric_limits<uint32_t>::max();
+                uint32_t generation = 0;
+
+                bool operator==(const handle&) const = default;
+            };
+
+            /**
+             * @brief Handle of the element at a position.\n
+             *        From the first handle on the vectormap tracks the position of every element with a
+             *        handle. That adds O(n) work only to edits that already shift O(n) elements.
+             * 
+             * @param pos      Position.
+             * @return handle  Handle of the element, or a default handle if pos is out of range.
+             *                 Every call for the same element returns the same handle.
+             */
+            handle make_handle(const size_type pos);
+            /**
+             * @brief Current position of the element of a handle, in O(1).
+             * 
+             * @return size_type  Position, or npos if the handle is stale.
+             */
+            size_type position(const handle h) const;
+            iterator get(const handle h) { size_type pos = position(h); return pos != npos ? iterator(data_ + pos) : end(); }
+            bool is_valid(const handle h) const { return position(h) != npos; }
+            /**
+             * @brief Makes a handle stale without erasing its element, so its slot can be reused.
+             * 
+             */
+            void release(const handle h);
+            /** @} */
             
             /** @name  Memory manipulation */
             /** @{ */
-            size_type size() { return size_; }
-            size_type capacity() { return capacity_; }
-            bool is_empty() { return ((data_ == nullptr) || (size_ == 0)); }
+            size_type size() const { return size_; }
+            size_type capacity() const { return capacity_; }
+            bool is_empty() const { return ((data_ == nullptr) || (size_ == 0)); }
+            size_type max_size() const { return allocator_traits::max_size(allocator_); }
             bool reserve(size_type min_capacity);
+            /**
+             * @brief Reserves memory reporting failures as an error code instead of an exception.
+             * 
+             * @param min_capacity      Minimum number of elements to hold.
+             * @return std::error_code  Empty on success, std::errc::invalid_argument if min_capacity < size(),
+             *                          std::errc::not_enough_memory or std::errc::value_too_large if allocating fails.
+             */
+            std::error_code try_reserve(size_type min_capacity);
             bool shrink() { return resize(size_); };
             bool resize(size_type new_capacity);
+            /**
+             * @brief Memory held by the vectormap, including the heap memory owned by keys and values.
+             * 
+             * @return memory_report  Object, buffer and heap bytes.
+             */
+            memory_report memory_usage() const;
+            /**
+             * @brief Releases capacity automatically when the elements fall below a fraction of it.\n
+             *        It is checked after every erasure; 0 disables it, which is the default.
+             * 
+             * @param min_load  Fraction of the capacity, clamped to [0, 1]. 1 keeps the capacity at the
+             *                  smallest multiple of delta_ above the size.
+             */
+            void set_shrink_policy(double min_load) { shrink_below_ = std::clamp(min_load, 0.0, 1.0); auto_shrink_(); }
+            double shrink_policy() const { return shrink_below_; }
+            /**
+             * @brief Spreads the construction, copy and destruction of the elements over several threads
+             *        once a vectormap holds at least threshold elements. It applies to the copy constructor,
+             *        copy assignment, resize(), clear() and the destructor; copies inherit the setting.\n
+             *        Disabled by default. The constructors and destructors of the elements, and the
+             *        allocator's construct() and destroy(), must be safe to call concurrently.
+             * 
+             * @param threshold  Minimum size to go parallel; npos disables it.
+             * @param threads    Maximum number of threads; 0 uses the hardware threads.
+             */
+            void set_parallel_threshold(size_type threshold, size_type threads = 0) { parallel_threshold_ = threshold; parallel_threads_ = threads; }
+            size_type parallel_threshold() const { return parallel_threshold_; }
+            /** @} */
+
+            /** @name  Hot key cache */
+            /** @{ */
+            /**
+             * @brief Keeps the first position of the most looked up keys, so the key lookups of get(),
+             *        get_value(), get_pos() and the functions built on them start there instead of at
+             *        the beginning. The order of the elements is not changed.\n
+             *        Keys are ranked by their number of lookups, halved periodically so the ranking
+             *        follows changes in the workload. Edits that shift positions or change keys make the
+             *        cached positions stale; each is found again by the next lookup of its key.
+             *        Appending at the end keeps them. Disabled by default.\n
+             *        While it is enabled every key lookup updates the cache, so lookups are writes: threads
+             *        that share the vectormap must not run them concurrently, not even with no other edit,
+             *        unless they are serialized by the caller. Give each reader thread its own copy or keep
+             *        the cache disabled on shared vectormaps.
+             * 
+             * @param entries  Number of keys to keep; 0 disables the cache.
+             */
+            void set_hot_cache(size_type entries);
+            size_type hot_cache() const { return hot_capacity_; }
+            hot_cache_stats get_hot_cache_stats() const { return hot_stats_; }
             /** @} */
 
             /** @name  Operators */
@@ -233,18 +794,19 @@ namespace com {
             iterator begin() { return iterator(data_); }
             iterator end() { return iterator(data_ + size_); }
 
-            reverse_iterator rbegin() { return reverse_iterator(data_ + size_); }
-            reverse_iterator rend() { return reverse_iterator(data_); }
+            reverse_iterator rbegin() { return reverse_iterator(end()); }
+            reverse_iterator rend() { return reverse_iterator(begin()); }
 
             const_iterator begin() const { return const_iterator(data_); }
             const_iterator end() const { return const_iterator(data_ + size_); }
             const_iterator cbegin() const { return const_iterator(data_); }
             const_iterator cend() const { return const_iterator(data_ + size_); }
 
-            const_reverse_iterator rbegin() const { return const_reverse_iterator(data_); }
-            const_reverse_iterator rend() const { return const_reverse_iterator(data_ + size_); }
-            const_reverse_iterator crbegin() const { return const_reverse_iterator(data_ + size_); }
-            const_reverse_iterator crbend() const { return const_reverse_iterator(data_); }
+            const_reverse_iterator rbegin() const { return const_reverse_iterator(cend()); }
+            const_reverse_iterator rend() const { return const_reverse_iterator(cbegin()); }
+            const_reverse_iterator crbegin() const { return const_reverse_iterator(cend()); }
+            const_reverse_iterator crend() const { return const_reverse_iterator(cbegin()); }
+            const_reverse_iterator crbend() const { return crend(); }
 
             iterator last() { return iterator(data_ + size_ - 1); }
             const_iterator last() const { return const_iterator(data_ + size_ - 1); }
@@ -259,36 +821,113 @@ namespace com {
             pointer data_ = nullptr;
             mapped_type void_mapped_type_;
             key_type void_key_type_;
-            bool gap_(size_type from, size_type length);
+            double shrink_below_ = 0;
+            size_type parallel_threshold_ = npos;
+            size_type parallel_threads_ = 0;
+
+            // Hot key cache. Positions cached at an older epoch_ are stale; every edit that shifts
+            // positions or changes keys starts a new epoch.
+            struct hot_entry_ {
+                key_type key;
+                size_type pos;
+                size_type hits;
+            };
+            static constexpr size_type hot_aging_ = 1024;
+            std::vector<hot_entry_> hot_;
+            size_type hot_capacity_ = 0;
+            size_type hot_epoch_ = 0;
+            size_type hot_lookups_ = 0;
+            hot_cache_stats hot_stats_;
+            size_type epoch_ = 0;
+
+            // Handle slots. A live slot holds the position of its element; a free one the next free slot.
+            // slot_of_ holds the slot of every position and stays empty until the first handle is made.
+            struct slot_ {
+                size_type pos;
+                uint32_t generation;
+            };
+            static constexpr uint32_t no_slot_ = std::numeric_limits<uint32_t>::max();
+            std::vector<slot_> slots_;
+            std::vector<uint32_t> slot_of_;
+            uint32_t free_slots_ = no_slot_;
+
+            void gap_(size_type from, size_type length);
+            void close_gap_(size_type from, size_type length) noexcept;
+            template<class Fill>
+            iterator insert_n_(const size_type pos, const size_type length, Fill fill);
+            pointer allocate_(size_type n);
+            void deallocate_(pointer p, size_type n);
+            void auto_shrink_();
+            template<class Construct>
+            void construct_n_(pointer dest, size_type n, Construct construct);
+            void destroy_n_(pointer p, size_type n) noexcept;
+            void permute_(std::vector<size_type>&& order);
+            void compact_(const std::vector<bool>& keep);
+            std::vector<size_type> key_groups_() const;
+            bool tracking_() const { return !slots_.empty(); }
+            size_type hot_find_(const key_type& key);
+            void hot_admit_(const key_type& key, size_type pos);
+            void free_slot_(uint32_t slot) noexcept;
+            void renumber_(size_type from, size_type to) noexcept;
+            // Notifications of the edits that move elements. They keep the handle slots and the hot cache coherent.
+            void positions_inserted_(size_type pos, size_type length);
+            void positions_erased_(size_type pos, size_type length) noexcept;
+            void positions_moved_(size_type from, size_type to) noexcept;
+            void positions_swapped_(size_type a, size_type b) noexcept;
+            std::vector<uint32_t> positions_prepare_(size_type new_size) const { return tracking_() ? std::vector<uint32_t>(new_size, no_slot_) : std::vector<uint32_t>(); }
+            template<class Source>
+            void positions_rebuilt_(std::vector<uint32_t>&& rebuilt, Source source) noexcept;
+            template<class Found>
+            size_type lookup_batch_(std::span<const key_type> keys, Found found) const;
+
+            struct key_ptr_hash_ {
+                size_t operator()(const key_type* k) const { return std::hash<key_type>{}(*k); }
+            };
+            struct key_ptr_equal_ {
+                bool operator()(const key_type* a, const key_type* b) const { return *a == *b; }
+            };
     };
 
-    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    vectormap<key_, value_, delta_>::vectormap(const std::initializer_list<value_type>& il) : capacity_(delta_), size_(0) {
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    vectormap<key_, value_, delta_, alloc_>::vectormap(const std::initializer_list<value_type>& il) : capacity_(delta_), size_(0) {
         if (capacity_ < il.size()) {
             capacity_ = ((il.size() / delta_) + 1) * delta_;
         }
 
-        data_ = allocator_traits::allocate(allocator_, capacity_);
-
-        size_type counter = 0;
-        for (auto elem : il) {
-            allocator_traits::construct(allocator_, data_ + counter, elem);
-            size_++;
-            counter++;
+        data_ = allocate_(capacity_);
+        try {
+            for (auto& elem : il) {
+                allocator_traits::construct(allocator_, data_ + size_, elem);
+                size_++;
+            }
+        }
+        catch (...) {
+            clear();
+            deallocate_(data_, capacity_);
+            throw;
         }
+        memory_registry::attach();
     }
 
-    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    vectormap<key_, value_, delta_>::vectormap(const vectormap &other) : capacity_(other.capacity_), size_(other.size_) {
-        data_ = allocator_traits::allocate(allocator_, capacity_);
-
-        for (size_type i = 0; i < size_; ++i) {
-            allocator_traits::construct(allocator_, data_ + i, std::make_pair(other.data_[i].first, other.data_[i].second));
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    vectormap<key_, value_, delta_, alloc_>::vectormap(const vectormap &other) : capacity_(other.capacity_), size_(0), shrink_below_(other.shrink_below_),
+                                                                 parallel_threshold_(other.parallel_threshold_), parallel_threads_(other.parallel_threads_),
+                                                                 hot_(other.hot_), hot_capacity_(other.hot_capacity_), hot_epoch_(other.hot_epoch_), epoch_(other.epoch_),
+                                                                 slots_(other.slots_), slot_of_(other.slot_of_), free_slots_(other.free_slots_) {
+        data_ = allocate_(capacity_);
+        try {
+            construct_n_(data_, other.size_, [&](pointer p, size_type i) { allocator_traits::construct(allocator_, p, other.data_[i]); });
+        }
+        catch (...) {
+            deallocate_(data_, capacity_);
+            throw;
         }
+        size_ = other.size_;
+        memory_registry::attach();
     }
 
-    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    vectormap<key_, value_, delta_>::vectormap(vectormap &&other) noexcept(allocator_traits::is_always_equal::value) {
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    vectormap<key_, value_, delta_, alloc_>::vectormap(vectormap &&other) noexcept(allocator_traits::is_always_equal::value) {
         if (allocator_traits::propagate_on_container_move_assignment::value) {
             allocator_ = std::move(other.allocator_);
         }
@@ -296,84 +935,178 @@ namespace com {
             allocator_ = other.allocator_;
         }
 
+        memory_registry::attach();
         data_ = std::exchange(other.data_, nullptr);
         size_ = std::exchange(other.size_, 0);
         capacity_ = std::exchange(other.capacity_, 0);
+        shrink_below_ = other.shrink_below_;
+        parallel_threshold_ = other.parallel_threshold_;
+        parallel_threads_ = other.parallel_threads_;
+        slots_ = std::move(other.slots_);
+        slot_of_ = std::move(other.slot_of_);
+        free_slots_ = std::exchange(other.free_slots_, no_slot_);
+        hot_ = std::exchange(other.hot_, {});
+        hot_capacity_ = other.hot_capacity_;
+        hot_epoch_ = other.hot_epoch_;
+        hot_lookups_ = other.hot_lookups_;
+        hot_stats_ = other.hot_stats_;
+        epoch_ = other.epoch_;
     }
 
-    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    vectormap<key_, value_, delta_>::~vectormap() {
-        for (size_type i = 0; i < size_; i++) {
-            allocator_traits::destroy(allocator_, data_ + i);
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    vectormap<key_, value_, delta_, alloc_>::~vectormap() {
+        destroy_n_(data_, size_);
+
+        deallocate_(data_, capacity_);
+        memory_registry::detach();
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_> 
+    vectormap<key_, value_, delta_, alloc_>::iterator vectormap<key_, value_, delta_, alloc_>::insert(const value_type &val, const size_type pos) {
+        // Shifting in place would move val away before it is copied.
+        if ((pos < size_) && (size_ < capacity_) && !std::less<const value_type*>{}(&val, data_) && std::less<const value_type*>{}(&val, data_ + size_)) {
+            value_type copy(val);
+            return insert_n_(pos, 1, [&](pointer p, size_type) { allocator_traits::construct(allocator_, p, std::move(copy)); });
         }
+        return insert_n_(pos, 1, [&](pointer p, size_type) { allocator_traits::construct(allocator_, p, val); });
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    template<class... Args>
+    vectormap<key_, value_, delta_, alloc_>::iterator vectormap<key_, value_, delta_, alloc_>::emplace(const size_type pos, Args&&... args) {
+        // Shifting in place could move away an element the arguments refer to, so the element
+        // is built beforehand, as std::vector::emplace does.
+        if ((pos < size_) && (size_ < capacity_)) {
+            value_type elem(std::forward<Args>(args)...);
+            return insert_n_(pos, 1, [&](pointer p, size_type) { allocator_traits::construct(allocator_, p, std::move(elem)); });
+        }
+        return insert_n_(pos, 1, [&](pointer p, size_type) { allocator_traits::construct(allocator_, p, std::forward<Args>(args)...); });
+    }
 
-        allocator_traits::deallocate(allocator_, data_, capacity_);
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    vectormap<key_, value_, delta_, alloc_>::iterator vectormap<key_, value_, delta_, alloc_>::insert(const std::initializer_list<value_type>& il, const size_type pos) {
+        return insert_n_(pos, il.size(), [&](pointer p, size_type i) { allocator_traits::construct(allocator_, p, *(il.begin() + i)); });
     }
 
-    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_> 
-    vectormap<key_, value_, delta_>::iterator vectormap<key_, value_, delta_>::insert(const value_type &val, const size_type pos) {
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    vectormap<key_, value_, delta_, alloc_>::iterator vectormap<key_, value_, delta_, alloc_>::insert(const vectormap& map, const size_type pos) {
+        if (&map == this) {
+            return insert(vectormap(map), pos);
+        }
+        return insert_n_(pos, map.size_, [&](pointer p, size_type i) { allocator_traits::construct(allocator_, p, map.data_[i]); });
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    std::error_code vectormap<key_, value_, delta_, alloc_>::try_insert(const value_type& val, const size_type pos) {
         if (pos > size_) {
-            return end();
+            return std::make_error_code(std::errc::result_out_of_range);
         }
-        else {
-            bool success = gap_(pos, 1);
-            
-            if (success) {            
-                allocator_traits::construct(allocator_, data_ + pos, val);
-                return iterator(&data_[pos]);
-            }
-            else {
-                return end();
-            }
+
+        try {
+            insert(val, pos);
+        }
+        catch (const std::bad_alloc&) {
+            return std::make_error_code(std::errc::not_enough_memory);
+        }
+        catch (const std::length_error&) {
+            return std::make_error_code(std::errc::value_too_large);
         }
+
+        return {};
     }
 
-    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    vectormap<key_, value_, delta_>::iterator vectormap<key_, value_, delta_>::insert(const std::initializer_list<value_type>& il, const size_type pos) {
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    template<class Fill>
+    vectormap<key_, value_, delta_, alloc_>::iterator vectormap<key_, value_, delta_, alloc_>::insert_n_(const size_type pos, const size_type length, Fill fill) {
         if (pos > size_) {
             return end();
         }
-        else {
-            bool success = gap_(pos, il.size());
-            if (success) {        
-                for (size_type i = 0; i < il.size(); i++) {
-                    allocator_traits::construct(allocator_, data_ + pos + i, *(il.begin() + i));
+        if (tracking_()) {
+            slot_of_.reserve(size_ + length);
+        }
+
+        if (size_ + length <= capacity_) {
+            // In place. If an element cannot be constructed the gap is closed again, leaving the
+            // vectormap as it was unless shifting the elements back throws as well.
+            gap_(pos, length);
+            size_type i = 0;
+            try {
+                for (; i < length; ++i) {
+                    fill(data_ + pos + i, i);
                 }
-                return iterator(data_ + pos);
             }
-            else {
-                return end();
+            catch (...) {
+                destroy_n_(data_ + pos, i);
+                close_gap_(pos, length);
+                throw;
             }
+
+            positions_inserted_(pos, length);
+            return iterator(data_ + pos);
         }
-    }
 
-    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    vectormap<key_, value_, delta_>::iterator vectormap<key_, value_, delta_>::insert(const vectormap<key_type, mapped_type, delta_>& map, const size_type pos) {
-        if (pos > size_) {
-            return end();
+        // Growing: the result is built in a new buffer and only replaces the current one on success.
+        if (size_ + length >= max_size() - delta_) {
+            throw std::length_error("vectormap::insert");
         }
-        else {
-            bool success = gap_(pos, map.size_);
-            if (success) {                
-                for (size_type i = 0; i < map.size_; i++) {
-                    allocator_traits::construct(allocator_, data_ + pos + i, 
-                        std::make_pair<>(map.data_[i].first, map.data_[i].second));
-                }
-                return iterator(data_ + pos);
+
+        size_type new_capacity = (((size_ + length) / delta_) + 1) * delta_;
+        pointer new_data = allocate_(new_capacity);
+        size_type filled = 0;
+        size_type built = 0;
+        try {
+            // The new elements go first, as their arguments may refer to the current ones.
+            for (; filled < length; ++filled) {
+                fill(new_data + pos + filled, filled);
             }
-            else {
-                return end();
+            for (; built < pos; ++built) {
+                allocator_traits::construct(allocator_, new_data + built, std::move_if_noexcept(data_[built]));
+            }
+            for (; built < size_; ++built) {
+                allocator_traits::construct(allocator_, new_data + built + length, std::move_if_noexcept(data_[built]));
+            }
+        }
+        catch (...) {
+            destroy_n_(new_data + pos, filled);
+            destroy_n_(new_data, std::min(built, pos));
+            if (built > pos) {
+                destroy_n_(new_data + pos + length, built - pos);
             }
+            deallocate_(new_data, new_capacity);
+            throw;
         }
+
+        destroy_n_(data_, size_);
+        deallocate_(data_, capacity_);
+
+        data_ = new_data;
+        size_ = size_ + length;
+        capacity_ = new_capacity;
+        positions_inserted_(pos, length);
+
+        return iterator(data_ + pos);
     }
 
-    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    std::vector<typename vectormap<key_, value_, delta_>::iterator_pos> vectormap<key_, value_, delta_>::get(const key_type& key, const size_type ordinal, size_type number) {
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    std::vector<typename vectormap<key_, value_, delta_, alloc_>::iterator_pos> vectormap<key_, value_, delta_, alloc_>::get(const key_type& key, const size_type ordinal, size_type number) {
         std::vector<iterator_pos> out;
         size_type order = 1;
-        
-        for (size_type i = 0; i < size_; ++i) {
+        size_type start = 0;
+        bool admit = false;
+
+        if (hot_capacity_ != 0) {
+            // Nothing before the first position of the key can match.
+            start = hot_find_(key);
+            admit = (start == npos);
+            start = admit ? 0 : start;
+        }
+
+        for (size_type i = start; i < size_; ++i) {
             if (data_[i].first == key) {
+                if (admit) {
+                    hot_admit_(key, i);
+                    admit = false;
+                }
                 if ((order >= ordinal) && (out.size() == (number - 1))) {
                     out.push_back(std::make_pair(iterator(&data_[i]), i));
                     return std::move(out);
@@ -391,8 +1124,8 @@ namespace com {
         return std::move(out);
     }
 
-    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    std::vector<typename vectormap<key_, value_, delta_>::iterator_pos> vectormap<key_, value_, delta_>::get_all(const key_type& key) {
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    std::vector<typename vectormap<key_, value_, delta_, alloc_>::iterator_pos> vectormap<key_, value_, delta_, alloc_>::get_all(const key_type& key) {
         std::vector<iterator_pos> out;
         for (size_type i = 0; i < size_; i++)
             if (data_[i].first == key) {
@@ -402,8 +1135,8 @@ namespace com {
         return out;
     }
 
-    template <DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    inline std::vector<typename vectormap<key_, value_, delta_>::mapped_type> vectormap<key_, value_, delta_>::get_value(const key_type &key, size_type ordinal, size_type number)
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    inline std::vector<typename vectormap<key_, value_, delta_, alloc_>::mapped_type> vectormap<key_, value_, delta_, alloc_>::get_value(const key_type &key, size_type ordinal, size_type number)
     {
         std::vector<mapped_type> out;
         std::vector<iterator_pos> get_ = get(key, ordinal, number);
@@ -415,8 +1148,8 @@ namespace com {
         return std::move(out);
     }
 
-    template <DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    std::vector<typename vectormap<key_, value_, delta_>::mapped_type> vectormap<key_, value_, delta_>::get_all_values(const key_type &key)
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    std::vector<typename vectormap<key_, value_, delta_, alloc_>::mapped_type> vectormap<key_, value_, delta_, alloc_>::get_all_values(const key_type &key)
     {
         std::vector<mapped_type> out;
         for (auto elem : get_all(key)) {
@@ -426,10 +1159,10 @@ namespace com {
         return out;
     }
 
-    template <DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    inline std::vector<typename vectormap<key_, value_, delta_>::size_type> vectormap<key_, value_, delta_>::get_pos(const key_type &key, size_type ordinal, size_type number)
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    inline std::vector<typename vectormap<key_, value_, delta_, alloc_>::size_type> vectormap<key_, value_, delta_, alloc_>::get_pos(const key_type &key, size_type ordinal, size_type number)
     {
-        std::vector<mapped_type> out;
+        std::vector<size_type> out;
         std::vector<iterator_pos> get_ = get(key, ordinal, number);
 
         for (size_type i = 0; i < get_.size(); ++i) {
@@ -439,8 +1172,8 @@ namespace com {
         return std::move(out);
     }
 
-    template <DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    inline std::vector<typename vectormap<key_, value_, delta_>::size_type> vectormap<key_, value_, delta_>::get_all_pos(const key_type &key)
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    inline std::vector<typename vectormap<key_, value_, delta_, alloc_>::size_type> vectormap<key_, value_, delta_, alloc_>::get_all_pos(const key_type &key)
     {
         std::vector<size_type> out;
         for (auto elem : get_all(key)) {
@@ -450,33 +1183,114 @@ namespace com {
         return out;
     }
 
-    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    void vectormap<key_, value_, delta_>::clear() {
-        for (size_type i = 0; i < size_; i++)
-            allocator_traits::destroy(allocator_, data_ + i);
-        size_ = 0;
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    typename vectormap<key_, value_, delta_, alloc_>::size_type vectormap<key_, value_, delta_, alloc_>::lookup_batch(std::span<const key_type> keys, std::span<size_type> out) const requires Hashable<key_type> {
+        return lookup_batch_(keys.first(std::min(keys.size(), out.size())), [&](size_type k, size_type pos) { out[k] = pos; });
     }
 
-    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    void vectormap<key_, value_, delta_>::erase(const size_type pos) {
-        if ((size_ > 0) && (pos < size_)) {
-            --size_;
-            for (size_type i = pos; i < size_; ++i) {
-                allocator_traits::destroy(allocator_, data_ + i);
-                allocator_traits::construct(allocator_, data_ + i, std::move(data_[i + 1]));
-            }
-        }
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    typename vectormap<key_, value_, delta_, alloc_>::size_type vectormap<key_, value_, delta_, alloc_>::lookup_batch(std::span<const key_type> keys, std::span<mapped_type*> out) requires Hashable<key_type> {
+        return lookup_batch_(keys.first(std::min(keys.size(), out.size())), [&](size_type k, size_type pos) {
+            out[k] = (pos != npos) ? &data_[pos].second : nullptr;
+        });
     }
 
-    template <DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    inline void vectormap<key_, value_, delta_>::erase(const std::initializer_list<size_type> &il) {
-        for (auto elem : il) {
-            erase(elem);
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    template<class Found>
+    typename vectormap<key_, value_, delta_, alloc_>::size_type vectormap<key_, value_, delta_, alloc_>::lookup_batch_(std::span<const key_type> keys, Found found) const {
+        constexpr size_type slots = 2 * lookup_block;
+        constexpr size_type prefetch_distance = 8;
+
+        // Open addressing table of the pending keys: slot -> 1 + index in the block, 0 if empty.
+        uint16_t table[slots];
+        size_t hashes[lookup_block];
+        size_type positions[lookup_block];
+        uint16_t alias[lookup_block];
+        size_type hits = 0;
+
+        for (size_type base = 0; base < keys.size(); base += lookup_block) {
+            size_type n = std::min(lookup_block, keys.size() - base);
+            size_type pending = 0;
+            std::fill(std::begin(table), std::end(table), uint16_t(0));
+
+            for (size_type j = 0; j < n; ++j) {
+                const key_type& key = keys[base + j];
+                hashes[j] = std::hash<key_type>{}(key);
+                positions[j] = npos;
+                alias[j] = uint16_t(j);
+
+                size_type slot = hashes[j] & (slots - 1);
+                for (; table[slot] != 0; slot = (slot + 1) & (slots - 1)) {
+                    size_type other = table[slot] - 1;
+                    if ((hashes[other] == hashes[j]) && (keys[base + other] == key)) {
+                        alias[j] = uint16_t(other);
+                        break;
+                    }
+                }
+                if (alias[j] == j) {
+                    table[slot] = uint16_t(j + 1);
+                    ++pending;
+                }
+            }
+
+            for (size_type i = 0; (i < size_) && (pending != 0); ++i) {
+#if defined(__GNUC__) || defined(__clang__)
+                if (i + prefetch_distance < size_) {
+                    __builtin_prefetch(data_ + i + prefetch_distance);
+                }
+#endif
+                size_t hash = std::hash<key_type>{}(data_[i].first);
+                for (size_type slot = hash & (slots - 1); table[slot] != 0; slot = (slot + 1) & (slots - 1)) {
+                    size_type j = table[slot] - 1;
+                    if ((hashes[j] == hash) && (positions[j] == npos) && (keys[base + j] == data_[i].first)) {
+                        positions[j] = i;
+                        --pending;
+                        break;
+                    }
+                }
+            }
+
+            for (size_type j = 0; j < n; ++j) {
+                size_type pos = positions[alias[j]];
+                hits += (pos != npos);
+                found(base + j, pos);
+            }
+        }
+
+        return hits;
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::clear() {
+        destroy_n_(data_, size_);
+        positions_erased_(0, size_);
+        size_ = 0;
+        auto_shrink_();
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::erase(const size_type pos) {
+        if ((size_ > 0) && (pos < size_)) {
+            --size_;
+            for (size_type i = pos; i < size_; ++i) {
+                allocator_traits::destroy(allocator_, data_ + i);
+                allocator_traits::construct(allocator_, data_ + i, std::move(data_[i + 1]));
+            }
+            allocator_traits::destroy(allocator_, data_ + size_);
+            positions_erased_(pos, 1);
+            auto_shrink_();
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    inline void vectormap<key_, value_, delta_, alloc_>::erase(const std::initializer_list<size_type> &il) {
+        for (auto elem : il) {
+            erase(elem);
         }
     }
 
-    template <DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    void vectormap<key_, value_, delta_>::erase_all(const key_type &key)
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::erase_all(const key_type &key)
     {
         auto v = get_all(key);
         for (auto it = v.rbegin(); it != v.rend(); ++it) {
@@ -484,126 +1298,1195 @@ namespace com {
         }
     }
 
-    template <DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    inline void vectormap<key_, value_, delta_>::move(const size_type from, const size_type to) {
-        if ((from < size_) && (to < size_)) {
-            gap_(to, 1);
-            allocator_traits::construct(allocator_, data_ + to, std::move(data_[from + 1]));
-            allocator_traits::destroy(allocator_, data_ + from + 1);
-            for (size_type i = from + 1; i < size_; ++i) {
-                allocator_traits::construct(allocator_, data_ + i, std::move(data_[i + 1]));
-                allocator_traits::destroy(allocator_, data_ + i + 1);
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    inline void vectormap<key_, value_, delta_, alloc_>::move(const size_type from, const size_type to) {
+        if ((from < size_) && (to < size_) && (from != to)) {
+            value_type temp_(std::move(data_[from]));
+            allocator_traits::destroy(allocator_, data_ + from);
+
+            // Shift the elements between both positions one place towards from.
+            if (from < to) {
+                for (size_type i = from; i < to; ++i) {
+                    allocator_traits::construct(allocator_, data_ + i, std::move(data_[i + 1]));
+                    allocator_traits::destroy(allocator_, data_ + i + 1);
+                }
             }
-            --size_;
-        }        
+            else {
+                for (size_type i = from; i > to; --i) {
+                    allocator_traits::construct(allocator_, data_ + i, std::move(data_[i - 1]));
+                    allocator_traits::destroy(allocator_, data_ + i - 1);
+                }
+            }
+
+            allocator_traits::construct(allocator_, data_ + to, std::move(temp_));
+            positions_moved_(from, to);
+        }
     }
 
-    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    inline void vectormap<key_, value_, delta_>::swap(const size_type from, const size_type to)
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    inline void vectormap<key_, value_, delta_, alloc_>::swap(const size_type from, const size_type to)
     {
-        if ((from < size_) && (to < size_)) {
-            value_type temp_ = data_[to];
+        if ((from < size_) && (to < size_) && (from != to)) {
+            value_type temp_(std::move(data_[to]));
 
             allocator_traits::destroy(allocator_, data_ + to);
             allocator_traits::construct(allocator_, data_ + to, std::move(data_[from]));
             allocator_traits::destroy(allocator_, data_ + from);
-            allocator_traits::construct(allocator_, data_ + from, temp_);
+            allocator_traits::construct(allocator_, data_ + from, std::move(temp_));
+            positions_swapped_(from, to);
         }
     }
 
-    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_> 
-    inline void vectormap<key_, value_, delta_>::swap(vectormap &a, vectormap &b) {
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::set(const value_type& new_value, const size_type pos)
+    {
+        // The key is const inside value_type, so the element is rebuilt from a copy made beforehand.
+        value_type temp_(new_value);
+
+        if (!(data_[pos].first == temp_.first)) {
+            ++epoch_;
+        }
+        allocator_traits::destroy(allocator_, data_ + pos);
+        allocator_traits::construct(allocator_, data_ + pos, std::move(temp_));
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    inline void vectormap<key_, value_, delta_, alloc_>::swap(vectormap &a, vectormap &b) {
         std::swap(a.allocator_, b.allocator_);
         std::swap(a.data_, b.data_);
         std::swap(a.size_, b.size_);
         std::swap(a.capacity_, b.capacity_);
+        std::swap(a.shrink_below_, b.shrink_below_);
+        std::swap(a.parallel_threshold_, b.parallel_threshold_);
+        std::swap(a.parallel_threads_, b.parallel_threads_);
+        std::swap(a.slots_, b.slots_);
+        std::swap(a.slot_of_, b.slot_of_);
+        std::swap(a.free_slots_, b.free_slots_);
+        std::swap(a.hot_, b.hot_);
+        std::swap(a.hot_capacity_, b.hot_capacity_);
+        std::swap(a.hot_epoch_, b.hot_epoch_);
+        std::swap(a.hot_lookups_, b.hot_lookups_);
+        std::swap(a.hot_stats_, b.hot_stats_);
+        std::swap(a.epoch_, b.epoch_);
     }
 
-    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    inline bool vectormap<key_, value_, delta_>::reserve(size_type min_capacity) {
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    inline bool vectormap<key_, value_, delta_, alloc_>::reserve(size_type min_capacity) {
         if (min_capacity < size_)
             return false;
 
+        if (min_capacity >= max_size() - delta_)
+            throw std::length_error("vectormap::reserve");
+
         size_type new_capacity = ((min_capacity / delta_) + 1) * delta_;
         return resize(new_capacity);
     }
 
-    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    bool vectormap<key_, value_, delta_>::resize(size_type new_capacity) {
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    std::error_code vectormap<key_, value_, delta_, alloc_>::try_reserve(size_type min_capacity) {
+        if (min_capacity < size_) {
+            return std::make_error_code(std::errc::invalid_argument);
+        }
+
+        try {
+            reserve(min_capacity);
+        }
+        catch (const std::bad_alloc&) {
+            return std::make_error_code(std::errc::not_enough_memory);
+        }
+        catch (const std::length_error&) {
+            return std::make_error_code(std::errc::value_too_large);
+        }
+
+        return {};
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    bool vectormap<key_, value_, delta_, alloc_>::resize(size_type new_capacity) {
         if (new_capacity < size_)
             return false;
 
-        pointer new_data = allocator_traits::allocate(allocator_, new_capacity);
-        for (size_type i = 0; i < size_ ; i++) {
-            allocator_traits::construct(allocator_, new_data + i, data_[i]);
-            allocator_traits::destroy(allocator_, data_ + i);
+        if (new_capacity > max_size())
+            throw std::length_error("vectormap::resize");
+
+        // Elements are moved when that cannot throw and copied otherwise, so a failure
+        // leaves the current buffer untouched.
+        pointer new_data = allocate_(new_capacity);
+        try {
+            construct_n_(new_data, size_, [&](pointer p, size_type i) { allocator_traits::construct(allocator_, p, std::move_if_noexcept(data_[i])); });
         }
-        
-        if (size_ != 0) {
-            allocator_traits::deallocate(allocator_, data_, capacity_);
+        catch (...) {
+            deallocate_(new_data, new_capacity);
+            throw;
         }
 
+        destroy_n_(data_, size_);
+        deallocate_(data_, capacity_);
+
         data_ = new_data;
         capacity_ = new_capacity;
 
         return true;
     }
 
-    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    vectormap<key_, value_, delta_> &vectormap<key_, value_, delta_>::operator=(const vectormap& other) {
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    vectormap<key_, value_, delta_, alloc_> &vectormap<key_, value_, delta_, alloc_>::operator=(const vectormap& other) {
         if (this != &other) {
-            clear();
-            if (other.size_ > capacity_) {
-                reserve(other.size_);
-            }
-            
-            for (size_type i = 0; i < other.size_; ++i) {
-                allocator_traits::construct(allocator_, data_ + i, std::make_pair(other.data_[i].first, other.data_[i].second));
-            }
+            vectormap copy(other);
+            swap(*this, copy);
         }
 
         return *this;
     }
 
-    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    vectormap<key_, value_, delta_>& vectormap<key_, value_, delta_>::operator=(vectormap&& other) {
-        std::swap(other.allocator_, allocator_);
-        data_ = std::exchange(other.data_, nullptr);
-        size_ = std::exchange(other.size_, 0);
-        std::swap(other.capacity_, capacity_);
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    vectormap<key_, value_, delta_, alloc_>& vectormap<key_, value_, delta_, alloc_>::operator=(vectormap&& other) {
+        if (this != &other) {
+            // Not clear(): the shrink policy would allocate a buffer only to release it below.
+            destroy_n_(data_, size_);
+            deallocate_(data_, capacity_);
+
+            std::swap(other.allocator_, allocator_);
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            capacity_ = std::exchange(other.capacity_, 0);
+            shrink_below_ = other.shrink_below_;
+            parallel_threshold_ = other.parallel_threshold_;
+            parallel_threads_ = other.parallel_threads_;
+            slots_ = std::move(other.slots_);
+            slot_of_ = std::move(other.slot_of_);
+            free_slots_ = std::exchange(other.free_slots_, no_slot_);
+            hot_ = std::exchange(other.hot_, {});
+            hot_capacity_ = other.hot_capacity_;
+            hot_epoch_ = other.hot_epoch_;
+            hot_lookups_ = other.hot_lookups_;
+            hot_stats_ = other.hot_stats_;
+            epoch_ = other.epoch_;
+        }
 
         return *this;
     }
 
-    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_>
-    bool vectormap<key_, value_, delta_>::gap_(size_type from, size_type length)
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::gap_(size_type from, size_type length)
     {
-        bool success = true;
-
-        if ((size_ + length) > capacity_) {
-            success = reserve(size_ + length);
+        // Opens length unconstructed slots at from; the capacity must already hold them.
+        // Only moving an element can throw (a const std::string key is copied), and then the
+        // elements already shifted are moved back.
+        size_type i = size_;
+        try {
+            for (; i > from; --i) {
+                allocator_traits::construct(allocator_, data_ + i - 1 + length, std::move(data_[i - 1]));
+                allocator_traits::destroy(allocator_, data_ + i - 1);
+            }
+        }
+        catch (...) {
+            size_ = size_ + length;
+            close_gap_(i, length);
+            throw;
         }
 
         size_ = size_ + length;
-        if (size_ <= length) {
-            return true;
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::close_gap_(size_type from, size_type length) noexcept
+    {
+        // Inverse of gap_(): the length slots at from are unconstructed. If an element cannot be
+        // moved back, it and the ones after it are dropped, as the basic guarantee allows.
+        size_type i = from + length;
+        try {
+            for (; i < size_; ++i) {
+                allocator_traits::construct(allocator_, data_ + i - length, std::move(data_[i]));
+                allocator_traits::destroy(allocator_, data_ + i);
+            }
+        }
+        catch (...) {
+            destroy_n_(data_ + i, size_ - i);
+            positions_erased_(i - length, size_ - i);
+            size_ = i - length;
+            return;
+        }
+
+        size_ = size_ - length;
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    typename vectormap<key_, value_, delta_, alloc_>::handle vectormap<key_, value_, delta_, alloc_>::make_handle(const size_type pos) {
+        if (pos >= size_) {
+            return handle();
+        }
+
+        if (!tracking_()) {
+            slot_of_.assign(size_, no_slot_);
+        }
+        else if (slot_of_[pos] != no_slot_) {
+            return handle{slot_of_[pos], slots_[slot_of_[pos]].generation};
+        }
+
+        uint32_t slot = free_slots_;
+        if (slot != no_slot_) {
+            free_slots_ = uint32_t(slots_[slot].pos);
+            slots_[slot].pos = pos;
+        }
+        else {
+            if (slots_.size() >= no_slot_) {
+                throw std::length_error("vectormap::make_handle");
+            }
+            slot = uint32_t(slots_.size());
+            slots_.push_back({pos, 0});
+        }
+
+        slot_of_[pos] = slot;
+        return handle{slot, slots_[slot].generation};
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    typename vectormap<key_, value_, delta_, alloc_>::size_type vectormap<key_, value_, delta_, alloc_>::position(const handle h) const {
+        return ((h.slot < slots_.size()) && (slots_[h.slot].generation == h.generation)) ? slots_[h.slot].pos : npos;
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::release(const handle h) {
+        size_type pos = position(h);
+        if (pos != npos) {
+            slot_of_[pos] = no_slot_;
+            free_slot_(h.slot);
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::free_slot_(uint32_t slot) noexcept {
+        // A new generation makes every handle to the slot stale.
+        ++slots_[slot].generation;
+        slots_[slot].pos = free_slots_;
+        free_slots_ = slot;
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::renumber_(size_type from, size_type to) noexcept {
+        for (size_type i = from; i < to; ++i) {
+            if (slot_of_[i] != no_slot_) {
+                slots_[slot_of_[i]].pos = i;
+            }
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::positions_inserted_(size_type pos, size_type length) {
+        // Callers reserve slot_of_ beforehand, so this cannot throw once the elements are in place.
+        if (pos + length != size_) {
+            ++epoch_;
+        }
+        if (tracking_()) {
+            slot_of_.insert(slot_of_.begin() + pos, length, no_slot_);
+            renumber_(pos + length, slot_of_.size());
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::positions_erased_(size_type pos, size_type length) noexcept {
+        ++epoch_;
+        if (tracking_()) {
+            for (size_type i = pos; i < pos + length; ++i) {
+                if (slot_of_[i] != no_slot_) {
+                    free_slot_(slot_of_[i]);
+                }
+            }
+            slot_of_.erase(slot_of_.begin() + pos, slot_of_.begin() + pos + length);
+            renumber_(pos, slot_of_.size());
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::positions_moved_(size_type from, size_type to) noexcept {
+        ++epoch_;
+        if (tracking_()) {
+            if (from < to) {
+                std::rotate(slot_of_.begin() + from, slot_of_.begin() + from + 1, slot_of_.begin() + to + 1);
+            }
+            else {
+                std::rotate(slot_of_.begin() + to, slot_of_.begin() + from, slot_of_.begin() + from + 1);
+            }
+            renumber_(std::min(from, to), std::max(from, to) + 1);
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::positions_swapped_(size_type a, size_type b) noexcept {
+        ++epoch_;
+        if (tracking_()) {
+            std::swap(slot_of_[a], slot_of_[b]);
+            renumber_(a, a + 1);
+            renumber_(b, b + 1);
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    template<class Source>
+    void vectormap<key_, value_, delta_, alloc_>::positions_rebuilt_(std::vector<uint32_t>&& rebuilt, Source source) noexcept {
+        // rebuilt comes from positions_prepare_() with the new size; source(i), called for increasing i,
+        // is the current position of the element that ends at i, or npos for a new element.
+        ++epoch_;
+        if (!tracking_()) {
+            return;
+        }
+
+        for (size_type i = 0; i < rebuilt.size(); ++i) {
+            size_type from = source(i);
+            if (from != npos) {
+                rebuilt[i] = std::exchange(slot_of_[from], no_slot_);
+            }
+        }
+        for (uint32_t slot : slot_of_) {
+            if (slot != no_slot_) {
+                free_slot_(slot);
+            }
+        }
+
+        slot_of_ = std::move(rebuilt);
+        renumber_(0, slot_of_.size());
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::set_hot_cache(size_type entries) {
+        hot_.clear();
+        hot_.shrink_to_fit();
+        hot_.reserve(entries);
+        hot_capacity_ = entries;
+        hot_stats_ = {};
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    typename vectormap<key_, value_, delta_, alloc_>::size_type vectormap<key_, value_, delta_, alloc_>::hot_find_(const key_type& key) {
+        // First position of key if it is cached and current, npos otherwise.
+        if (hot_epoch_ != epoch_) {
+            for (hot_entry_& entry : hot_) {
+                entry.pos = npos;
+            }
+            hot_epoch_ = epoch_;
+        }
+        if (++hot_lookups_ % hot_aging_ == 0) {
+            for (hot_entry_& entry : hot_) {
+                entry.hits /= 2;
+            }
+        }
+
+        for (hot_entry_& entry : hot_) {
+            if (entry.key == key) {
+                ++entry.hits;
+                if (entry.pos != npos) {
+                    ++hot_stats_.hits;
+                    return entry.pos;
+                }
+                break;
+            }
+        }
+
+        ++hot_stats_.misses;
+        return npos;
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::hot_admit_(const key_type& key, size_type pos) {
+        // Refreshes the position of a cached key. When the cache is full, every admission wears down the
+        // least looked up key, which is replaced once it runs out of hits; a burst of one-off keys cannot
+        // flush the hot ones.
+        hot_entry_* coldest = nullptr;
+        for (hot_entry_& entry : hot_) {
+            if (entry.key == key) {
+                entry.pos = pos;
+                return;
+            }
+            if ((coldest == nullptr) || (entry.hits < coldest->hits)) {
+                coldest = &entry;
+            }
+        }
+
+        if (hot_.size() < hot_capacity_) {
+            hot_.push_back({key, pos, 1});
+        }
+        else if ((coldest != nullptr) && (coldest->hits-- <= 1)) {
+            *coldest = {key, pos, 1};
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    memory_report vectormap<key_, value_, delta_, alloc_>::memory_usage() const {
+        memory_report report;
+        report.object_bytes = sizeof(*this);
+        report.buffer_bytes = capacity_ * sizeof(value_type);
+        report.used_bytes = size_ * sizeof(value_type);
+
+        if constexpr (!(std::is_arithmetic_v<key_type> && std::is_arithmetic_v<mapped_type>)) {
+            heap_usage<key_type> key_usage;
+            heap_usage<mapped_type> value_usage;
+            for (size_type i = 0; i < size_; ++i) {
+                report.heap_bytes += key_usage(data_[i].first) + value_usage(data_[i].second);
+            }
+        }
+        report.heap_bytes += slots_.capacity() * sizeof(slot_) + slot_of_.capacity() * sizeof(uint32_t);
+
+        // The hot key cache holds its own copies of the keys.
+        report.heap_bytes += hot_.capacity() * sizeof(hot_entry_);
+        if constexpr (!std::is_arithmetic_v<key_type>) {
+            heap_usage<key_type> key_usage;
+            for (const hot_entry_& entry : hot_) {
+                report.heap_bytes += key_usage(entry.key);
+            }
+        }
+
+        return report;
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    typename vectormap<key_, value_, delta_, alloc_>::pointer vectormap<key_, value_, delta_, alloc_>::allocate_(size_type n) {
+        pointer p = allocator_traits::allocate(allocator_, n);
+        memory_registry::allocated(n * sizeof(value_type));
+        return p;
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::deallocate_(pointer p, size_type n) {
+        if (p != nullptr) {
+            allocator_traits::deallocate(allocator_, p, n);
+            memory_registry::deallocated(n * sizeof(value_type));
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::auto_shrink_() {
+        if ((shrink_below_ > 0) && (capacity_ > delta_) && (double(size_) < shrink_below_ * double(capacity_))) {
+            // Capacities are multiples of delta_, so the buffer is only replaced when that saves at least one step.
+            size_type new_capacity = ((size_ / delta_) + 1) * delta_;
+            if (new_capacity >= capacity_) {
+                return;
+            }
+            // Shrinking is opportunistic: if the smaller buffer cannot be allocated, or an element
+            // cannot be copied into it, the current one is kept unchanged.
+            try {
+                resize(new_capacity);
+            }
+            catch (...) {
+            }
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    template<class Proj, class Compare>
+    void vectormap<key_, value_, delta_, alloc_>::sort_by(Proj proj, Compare comp) {
+        std::vector<size_type> order(size_);
+        std::iota(order.begin(), order.end(), size_type(0));
+
+        std::stable_sort(order.begin(), order.end(), [&](size_type a, size_type b) {
+            return std::invoke(comp, std::invoke(proj, std::as_const(data_[a])), std::invoke(proj, std::as_const(data_[b])));
+        });
+
+        permute_(std::move(order));
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    template<class Proj, class Compare>
+    void vectormap<key_, value_, delta_, alloc_>::sort_by(parallel_t, Proj proj, Compare comp) {
+        std::vector<size_type> order(size_);
+        std::iota(order.begin(), order.end(), size_type(0));
+
+        auto less = [&](size_type a, size_type b) {
+            return std::invoke(comp, std::invoke(proj, std::as_const(data_[a])), std::invoke(proj, std::as_const(data_[b])));
+        };
+
+        // Every thread sorts its own run, then the runs are merged pairwise in parallel rounds.
+        std::vector<size_type> bounds;
+        std::mutex bounds_mutex;
+        detail::parallel_for(size_, parallel_t::grain, [&](size_t begin, size_t end) {
+            std::stable_sort(order.begin() + begin, order.begin() + end, less);
+            std::lock_guard<std::mutex> lock(bounds_mutex);
+            bounds.push_back(begin);
+        });
+        std::sort(bounds.begin(), bounds.end());
+        bounds.push_back(size_);
+
+        while (bounds.size() > 2) {
+            size_type merges = (bounds.size() - 1) / 2;
+            detail::parallel_for(merges, 1, [&](size_t begin, size_t end) {
+                for (size_t m = begin; m < end; ++m) {
+                    std::inplace_merge(order.begin() + bounds[2 * m], order.begin() + bounds[2 * m + 1], order.begin() + bounds[2 * m + 2], less);
+                }
+            });
+
+            std::vector<size_type> merged;
+            for (size_type i = 0; i < bounds.size(); i += 2) {
+                merged.push_back(bounds[i]);
+            }
+            if (merged.back() != size_) {
+                merged.push_back(size_);
+            }
+            bounds = std::move(merged);
+        }
+
+        permute_(std::move(order));
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::dedupe_keys(dedupe_policy policy) {
+        std::vector<size_type> groups = key_groups_();
+        std::vector<size_type> survivor(size_, npos);
+
+        for (size_type i = 0; i < size_; ++i) {
+            if ((policy == dedupe_policy::keep_last) || (survivor[groups[i]] == npos)) {
+                survivor[groups[i]] = i;
+            }
+        }
+
+        std::vector<bool> keep(size_);
+        for (size_type i = 0; i < size_; ++i) {
+            keep[i] = (survivor[groups[i]] == i);
+        }
+
+        compact_(keep);
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    template<class Merge>
+        requires std::invocable<Merge&, typename vectormap<key_, value_, delta_, alloc_>::mapped_type&, typename vectormap<key_, value_, delta_, alloc_>::mapped_type&&>
+    void vectormap<key_, value_, delta_, alloc_>::dedupe_keys(Merge merge_fn) {
+        std::vector<size_type> groups = key_groups_();
+        std::vector<size_type> survivor(size_, npos);
+        std::vector<bool> keep(size_);
+
+        for (size_type i = 0; i < size_; ++i) {
+            if (survivor[groups[i]] == npos) {
+                survivor[groups[i]] = i;
+                keep[i] = true;
+            }
+            else {
+                std::invoke(merge_fn, data_[survivor[groups[i]]].second, std::move(data_[i].second));
+            }
+        }
+
+        compact_(keep);
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::group_by_key() {
+        std::vector<size_type> groups = key_groups_();
+
+        // Counting sort of the positions by group, which keeps the insertion order inside every group.
+        std::vector<size_type> start(size_ + 1, 0);
+        for (size_type i = 0; i < size_; ++i) {
+            ++start[groups[i] + 1];
         }
+        std::partial_sum(start.begin(), start.end(), start.begin());
 
-        if (success) {
-            if (from >= size_){
-                return true;
+        std::vector<size_type> order(size_);
+        for (size_type i = 0; i < size_; ++i) {
+            order[start[groups[i]]++] = i;
+        }
+
+        permute_(std::move(order));
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    template<class Construct>
+    void vectormap<key_, value_, delta_, alloc_>::construct_n_(pointer dest, size_type n, Construct construct) {
+        // Builds dest[0, n) with construct(p, i). If any element throws, every element built so far
+        // is destroyed before the exception propagates.
+        if (n < parallel_threshold_) {
+            size_type i = 0;
+            try {
+                for (; i < n; ++i) {
+                    construct(dest + i, i);
+                }
+            }
+            catch (...) {
+                destroy_n_(dest, i);
+                throw;
+            }
+            return;
+        }
+
+        // Reserved up front so recording a finished chunk cannot throw.
+        std::vector<std::pair<size_type, size_type>> built;
+        built.reserve(std::min<size_type>(n, (parallel_threads_ != 0) ? parallel_threads_ : std::max(1u, std::thread::hardware_concurrency())));
+        std::mutex built_mutex;
+        try {
+            detail::parallel_for(n, 1, [&](size_t begin, size_t end) {
+                size_t i = begin;
+                try {
+                    for (; i < end; ++i) {
+                        construct(dest + i, i);
+                    }
+                }
+                catch (...) {
+                    for (size_t j = begin; j < i; ++j) {
+                        allocator_traits::destroy(allocator_, dest + j);
+                    }
+                    throw;
+                }
+                std::lock_guard<std::mutex> lock(built_mutex);
+                built.emplace_back(begin, end);
+            }, parallel_threads_);
+        }
+        catch (...) {
+            for (auto [begin, end] : built) {
+                for (size_type j = begin; j < end; ++j) {
+                    allocator_traits::destroy(allocator_, dest + j);
+                }
+            }
+            throw;
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::destroy_n_(pointer p, size_type n) noexcept {
+        if constexpr (!std::is_trivially_destructible_v<value_type>) {
+            if (n < parallel_threshold_) {
+                for (size_type i = 0; i < n; ++i) {
+                    allocator_traits::destroy(allocator_, p + i);
+                }
+                return;
+            }
+
+            auto destroy = [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    allocator_traits::destroy(allocator_, p + i);
+                }
+            };
+            try {
+                detail::parallel_for(n, 1, destroy, parallel_threads_);
+            }
+            catch (...) {
+                // destroy cannot throw, so parallel_for failed before destroying anything.
+                destroy(0, n);
+            }
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::permute_(std::vector<size_type>&& order) {
+        // order[i] is the current position of the element that must end at position i.
+        // Every cycle of the permutation is rotated through a single temporary.
+        positions_rebuilt_(positions_prepare_(size_), [&](size_type i) { return order[i]; });
+
+        for (size_type i = 0; i < size_; ++i) {
+            if (order[i] == i) {
+                continue;
+            }
+
+            value_type temp_(std::move(data_[i]));
+            allocator_traits::destroy(allocator_, data_ + i);
+
+            size_type j = i;
+            while (order[j] != i) {
+                size_type k = order[j];
+                allocator_traits::construct(allocator_, data_ + j, std::move(data_[k]));
+                allocator_traits::destroy(allocator_, data_ + k);
+                order[j] = j;
+                j = k;
+            }
+
+            allocator_traits::construct(allocator_, data_ + j, std::move(temp_));
+            order[j] = j;
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::compact_(const std::vector<bool>& keep) {
+        size_type kept = tracking_() ? size_type(std::count(keep.begin(), keep.end(), true)) : 0;
+        size_type next = 0;
+        positions_rebuilt_(positions_prepare_(kept), [&](size_type) {
+            while (!keep[next]) {
+                ++next;
+            }
+            return next++;
+        });
+
+        size_type out = 0;
+        for (size_type i = 0; i < size_; ++i) {
+            if (keep[i]) {
+                if (out != i) {
+                    allocator_traits::construct(allocator_, data_ + out, std::move(data_[i]));
+                    allocator_traits::destroy(allocator_, data_ + i);
+                }
+                ++out;
             }
             else {
-                for (size_type i = size_ - 1; ((i > from) && ((i - length) != npos)); i--) {
-                    allocator_traits::construct(allocator_, data_ + i, std::move(data_[i - length]));
-                    allocator_traits::destroy(allocator_, data_ + i - length);
+                allocator_traits::destroy(allocator_, data_ + i);
+            }
+        }
+
+        size_ = out;
+        auto_shrink_();
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    std::vector<typename vectormap<key_, value_, delta_, alloc_>::size_type> vectormap<key_, value_, delta_, alloc_>::key_groups_() const {
+        // Group number of every element, numbering the keys in the order they are first seen.
+        std::vector<size_type> groups(size_);
+        size_type next = 0;
+
+        if constexpr (Hashable<key_type>) {
+            std::unordered_map<const key_type*, size_type, key_ptr_hash_, key_ptr_equal_> ids;
+            ids.reserve(size_);
+            for (size_type i = 0; i < size_; ++i) {
+                auto [it, inserted] = ids.try_emplace(&data_[i].first, next);
+                if (inserted) {
+                    ++next;
+                }
+                groups[i] = it->second;
+            }
+        }
+        else {
+            std::vector<size_type> firsts;
+            for (size_type i = 0; i < size_; ++i) {
+                size_type g = 0;
+                while ((g < firsts.size()) && !(data_[firsts[g]].first == data_[i].first)) {
+                    ++g;
+                }
+                if (g == firsts.size()) {
+                    firsts.push_back(i);
+                    ++next;
+                }
+                groups[i] = g;
+            }
+        }
+
+        return groups;
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    typename vectormap<key_, value_, delta_, alloc_>::patch vectormap<key_, value_, delta_, alloc_>::diff(const vectormap& a, const vectormap& b)
+        requires Hashable<key_type> && std::equality_comparable<mapped_type> {
+        // Positions of every key in a, consumed in order while b is scanned.
+        std::unordered_map<const key_type*, std::pair<std::vector<size_type>, size_type>, key_ptr_hash_, key_ptr_equal_> occurrences;
+        occurrences.reserve(a.size_);
+        for (size_type i = 0; i < a.size_; ++i) {
+            occurrences[&a.data_[i].first].first.push_back(i);
+        }
+
+        std::vector<size_type> match(b.size_, npos);
+        std::vector<bool> matched(a.size_, false);
+        for (size_type j = 0; j < b.size_; ++j) {
+            auto it = occurrences.find(&b.data_[j].first);
+            if ((it != occurrences.end()) && (it->second.second < it->second.first.size())) {
+                match[j] = it->second.first[it->second.second++];
+                matched[match[j]] = true;
+            }
+        }
+
+        // Longest increasing subsequence of the matched positions: those elements stay, the rest move.
+        std::vector<size_type> tails;
+        std::vector<size_type> parent(b.size_, npos);
+        for (size_type j = 0; j < b.size_; ++j) {
+            if (match[j] == npos) {
+                continue;
+            }
+            auto it = std::lower_bound(tails.begin(), tails.end(), match[j], [&](size_type t, size_type v) { return match[t] < v; });
+            if (it != tails.begin()) {
+                parent[j] = *(it - 1);
+            }
+            if (it == tails.end()) {
+                tails.push_back(j);
+            }
+            else {
+                *it = j;
+            }
+        }
+
+        std::vector<bool> stays(b.size_, false);
+        for (size_type j = tails.empty() ? npos : tails.back(); j != npos; j = parent[j]) {
+            stays[j] = true;
+        }
+
+        patch out;
+        for (size_type i = 0; i < a.size_; ++i) {
+            if (!matched[i]) {
+                out.push_back({edit_kind::removed, a.data_[i].first, a.data_[i].second, i, npos});
+            }
+        }
+
+        for (size_type j = 0; j < b.size_; ++j) {
+            size_type i = match[j];
+            if (i == npos) {
+                out.push_back({edit_kind::added, b.data_[j].first, b.data_[j].second, npos, j});
+                continue;
+            }
+            if (!stays[j]) {
+                out.push_back({edit_kind::moved, b.data_[j].first, b.data_[j].second, i, j});
+            }
+            if (!(a.data_[i].second == b.data_[j].second)) {
+                out.push_back({edit_kind::changed, b.data_[j].first, b.data_[j].second, i, j});
+            }
+        }
+
+        return out;
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    bool vectormap<key_, value_, delta_, alloc_>::apply(const patch& p) {
+        size_type removed = 0;
+        size_type added = 0;
+        for (const edit& e : p) {
+            removed += (e.kind == edit_kind::removed);
+            added += (e.kind == edit_kind::added);
+        }
+        if (removed > size_) {
+            return false;
+        }
+
+        // For every final position, the old position it comes from or the added edit that fills it.
+        size_type new_size = size_ - removed + added;
+        std::vector<size_type> source(new_size, npos);
+        std::vector<const edit*> inserted(new_size, nullptr);
+        std::vector<const edit*> changed(size_, nullptr);
+        std::vector<bool> taken(size_, false);
+
+        for (const edit& e : p) {
+            switch (e.kind) {
+                case edit_kind::removed:
+                    if ((e.from >= size_) || taken[e.from]) {
+                        return false;
+                    }
+                    taken[e.from] = true;
+                    break;
+                case edit_kind::added:
+                    if ((e.to >= new_size) || (source[e.to] != npos) || (inserted[e.to] != nullptr)) {
+                        return false;
+                    }
+                    inserted[e.to] = &e;
+                    break;
+                case edit_kind::moved:
+                    if ((e.from >= size_) || taken[e.from] || (e.to >= new_size) || (source[e.to] != npos) || (inserted[e.to] != nullptr)) {
+                        return false;
+                    }
+                    taken[e.from] = true;
+                    source[e.to] = e.from;
+                    break;
+                case edit_kind::changed:
+                    if (e.from >= size_) {
+                        return false;
+                    }
+                    changed[e.from] = &e;
+                    break;
+            }
+        }
+
+        // The elements that neither move nor disappear fill the free positions in their current order.
+        size_type next = 0;
+        for (size_type to = 0; to < new_size; ++to) {
+            if ((source[to] != npos) || (inserted[to] != nullptr)) {
+                continue;
+            }
+            while ((next < size_) && taken[next]) {
+                ++next;
+            }
+            if (next == size_) {
+                return false;
+            }
+            source[to] = next++;
+        }
+
+        std::vector<uint32_t> handles = positions_prepare_(new_size);
+        size_type new_capacity = (new_size > capacity_) ? ((new_size / delta_) + 1) * delta_ : capacity_;
+        pointer new_data = allocate_(new_capacity);
+        size_type built = 0;
+        try {
+            for (; built < new_size; ++built) {
+                if (inserted[built] != nullptr) {
+                    allocator_traits::construct(allocator_, new_data + built, inserted[built]->key, inserted[built]->value);
+                }
+                else if (changed[source[built]] != nullptr) {
+                    allocator_traits::construct(allocator_, new_data + built, data_[source[built]].first, changed[source[built]]->value);
+                }
+                else {
+                    allocator_traits::construct(allocator_, new_data + built, std::move_if_noexcept(data_[source[built]]));
+                }
+            }
+        }
+        catch (...) {
+            // Elements taken with a nothrow move go back to their place; the others were copied.
+            for (size_type j = 0; j < built; ++j) {
+                if (std::is_nothrow_move_constructible_v<value_type> && (inserted[j] == nullptr) && (changed[source[j]] == nullptr)) {
+                    allocator_traits::destroy(allocator_, data_ + source[j]);
+                    allocator_traits::construct(allocator_, data_ + source[j], std::move(new_data[j]));
                 }
-                return true;
+                allocator_traits::destroy(allocator_, new_data + j);
+            }
+            deallocate_(new_data, new_capacity);
+            throw;
+        }
+
+        for (size_type i = 0; i < size_; ++i) {
+            allocator_traits::destroy(allocator_, data_ + i);
+        }
+        deallocate_(data_, capacity_);
+
+        positions_rebuilt_(std::move(handles), [&](size_type to) { return source[to]; });
+        data_ = new_data;
+        size_ = new_size;
+        capacity_ = new_capacity;
+        auto_shrink_();
+
+        return true;
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::merge(const vectormap& other, merge_policy policy) requires Hashable<key_type> {
+        switch (policy) {
+            case merge_policy::keep_ours:
+                merge(other, [](mapped_type&, const mapped_type&) {});
+                break;
+            case merge_policy::keep_theirs:
+                merge(other, [](mapped_type& ours, const mapped_type& theirs) { ours = theirs; });
+                break;
+            case merge_policy::keep_both:
+                if (&other == this) {
+                    // Appending grows and may reallocate the storage being read.
+                    merge(vectormap(other), policy);
+                    return;
+                }
+                if ((size_ + other.size_ > capacity_) && !reserve(size_ + other.size_)) {
+                    return;
+                }
+                if (tracking_()) {
+                    slot_of_.reserve(size_ + other.size_);
+                }
+                for (size_type j = 0; j < other.size_; ++j) {
+                    allocator_traits::construct(allocator_, data_ + size_, other.data_[j].first, other.data_[j].second);
+                    ++size_;
+                    positions_inserted_(size_ - 1, 1);
+                }
+                break;
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    template<class Merge>
+        requires Hashable<key_> && std::invocable<Merge&, typename vectormap<key_, value_, delta_, alloc_>::mapped_type&, const typename vectormap<key_, value_, delta_, alloc_>::mapped_type&>
+    void vectormap<key_, value_, delta_, alloc_>::merge(const vectormap& other, Merge merge_fn) {
+        if (&other == this) {
+            merge(vectormap(other), merge_fn);
+            return;
+        }
+
+        // Target of every element of other: a position of this vectormap, or the position
+        // it takes once the keys missing here are appended.
+        std::unordered_map<const key_type*, size_type, key_ptr_hash_, key_ptr_equal_> index;
+        index.reserve(size_ + other.size_);
+        for (size_type i = 0; i < size_; ++i) {
+            index.try_emplace(&data_[i].first, i);
+        }
+
+        std::vector<size_type> target(other.size_);
+        std::vector<size_type> appended;
+        for (size_type j = 0; j < other.size_; ++j) {
+            auto [it, inserted] = index.try_emplace(&other.data_[j].first, size_ + appended.size());
+            if (inserted) {
+                appended.push_back(j);
+            }
+            target[j] = it->second;
+        }
+
+        if ((size_ + appended.size() > capacity_) && !reserve(size_ + appended.size())) {
+            return;
+        }
+
+        if (tracking_()) {
+            slot_of_.reserve(size_ + appended.size());
+        }
+        size_type base = size_;
+        for (size_type j : appended) {
+            allocator_traits::construct(allocator_, data_ + size_, other.data_[j].first, other.data_[j].second);
+            ++size_;
+            positions_inserted_(size_ - 1, 1);
+        }
+
+        for (size_type j = 0; j < other.size_; ++j) {
+            if ((target[j] < base) || (appended[target[j] - base] != j)) {
+                std::invoke(merge_fn, data_[target[j]].second, other.data_[j].second);
+            }
+        }
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::intersect(const vectormap& other) requires Hashable<key_type> {
+        std::unordered_map<const key_type*, bool, key_ptr_hash_, key_ptr_equal_> keys;
+        keys.reserve(other.size_);
+        for (size_type j = 0; j < other.size_; ++j) {
+            keys.try_emplace(&other.data_[j].first, true);
+        }
+
+        std::vector<bool> keep(size_);
+        for (size_type i = 0; i < size_; ++i) {
+            keep[i] = keys.contains(&data_[i].first);
+        }
+
+        compact_(keep);
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    bool vectormap<key_, value_, delta_, alloc_>::batch::insert(const value_type& val, const size_type pos) {
+        if (pos > size_) {
+            return false;
+        }
+
+        auto [r, offset] = locate_(pos);
+        values_.push_back(val);
+        run_ added = {false, values_.size() - 1, 1};
+
+        if (offset == 0) {
+            // Consecutive insertions extend the previous run instead of creating a new one.
+            if ((r > 0) && !runs_[r - 1].original && (runs_[r - 1].first + runs_[r - 1].count == added.first)) {
+                ++runs_[r - 1].count;
+            }
+            else {
+                runs_.insert(runs_.begin() + r, added);
             }
         }
         else {
+            run_ tail = {runs_[r].original, runs_[r].first + offset, runs_[r].count - offset};
+            runs_[r].count = offset;
+            runs_.insert(runs_.begin() + r + 1, {added, tail});
+        }
+
+        ++size_;
+        return true;
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    bool vectormap<key_, value_, delta_, alloc_>::batch::erase(const size_type pos) {
+        if (pos >= size_) {
             return false;
         }
+
+        auto [r, offset] = locate_(pos);
+        run_& run = runs_[r];
+
+        if (run.count == 1) {
+            runs_.erase(runs_.begin() + r);
+        }
+        else if (offset == 0) {
+            ++run.first;
+            --run.count;
+        }
+        else if (offset == run.count - 1) {
+            --run.count;
+        }
+        else {
+            run_ tail = {run.original, run.first + offset + 1, run.count - offset - 1};
+            run.count = offset;
+            runs_.insert(runs_.begin() + r + 1, tail);
+        }
+
+        --size_;
+        return true;
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    typename vectormap<key_, value_, delta_, alloc_>::pointer vectormap<key_, value_, delta_, alloc_>::batch::get(const size_type pos) {
+        if (pos >= size_) {
+            return nullptr;
+        }
+
+        auto [r, offset] = locate_(pos);
+        return runs_[r].original ? map_.data_ + runs_[r].first + offset : &values_[runs_[r].first + offset];
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::batch::commit() {
+        if (!is_pending()) {
+            return;
+        }
+
+        std::vector<uint32_t> handles = map_.positions_prepare_(size_);
+        size_type new_capacity = (size_ > map_.capacity_) ? ((size_ / delta_) + 1) * delta_ : map_.capacity_;
+        pointer new_data = map_.allocate_(new_capacity);
+
+        size_type out = 0;
+        try {
+            for (const run_& run : runs_) {
+                for (size_type i = run.first; i < run.first + run.count; ++i) {
+                    allocator_traits::construct(map_.allocator_, new_data + out, std::move_if_noexcept(run.original ? map_.data_[i] : values_[i]));
+                    ++out;
+                }
+            }
+        }
+        catch (...) {
+            // Elements taken with a nothrow move go back to the vectormap or to values_; the others were
+            // copied. The batch stays pending.
+            size_type j = 0;
+            for (const run_& run : runs_) {
+                for (size_type i = run.first; (i < run.first + run.count) && (j < out); ++i, ++j) {
+                    if constexpr (std::is_nothrow_move_constructible_v<value_type>) {
+                        if (run.original) {
+                            allocator_traits::destroy(map_.allocator_, map_.data_ + i);
+                            allocator_traits::construct(map_.allocator_, map_.data_ + i, std::move(new_data[j]));
+                        }
+                        else {
+                            std::destroy_at(&values_[i]);
+                            std::construct_at(&values_[i], std::move(new_data[j]));
+                        }
+                    }
+                    allocator_traits::destroy(map_.allocator_, new_data + j);
+                }
+            }
+            map_.deallocate_(new_data, new_capacity);
+            throw;
+        }
+
+        for (size_type i = 0; i < map_.size_; ++i) {
+            allocator_traits::destroy(map_.allocator_, map_.data_ + i);
+        }
+        map_.deallocate_(map_.data_, map_.capacity_);
+
+        size_type r = 0;
+        size_type offset = 0;
+        map_.positions_rebuilt_(std::move(handles), [&](size_type) {
+            while (offset == runs_[r].count) {
+                ++r;
+                offset = 0;
+            }
+            size_type from = runs_[r].original ? runs_[r].first + offset : npos;
+            ++offset;
+            return from;
+        });
+        map_.data_ = new_data;
+        map_.size_ = size_;
+        map_.capacity_ = new_capacity;
+        map_.auto_shrink_();
+
+        discard();
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    void vectormap<key_, value_, delta_, alloc_>::batch::discard() {
+        runs_.assign(1, {true, 0, map_.size_});
+        values_.clear();
+        size_ = map_.size_;
+    }
+
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    std::pair<typename vectormap<key_, value_, delta_, alloc_>::size_type, typename vectormap<key_, value_, delta_, alloc_>::size_type>
+    vectormap<key_, value_, delta_, alloc_>::batch::locate_(const size_type pos) const {
+        // Run holding pos and the offset of pos inside it; pos == size() maps past the last run.
+        size_type start = 0;
+        for (size_type r = 0; r < runs_.size(); ++r) {
+            if (pos < start + runs_[r].count) {
+                return std::make_pair(r, pos - start);
+            }
+            start += runs_[r].count;
+        }
+
+        return std::make_pair(runs_.size(), size_type(0));
+    }
+
+    /**
+     * @brief Edit script that turns a into b. See vectormap::diff().
+     * 
+     */
+    template<DefaultInitializableKeyable key_, std::default_initializable value_, size_t delta_, class alloc_>
+    typename vectormap<key_, value_, delta_, alloc_>::patch diff(const vectormap<key_, value_, delta_, alloc_>& a, const vectormap<key_, value_, delta_, alloc_>& b) {
+        return vectormap<key_, value_, delta_, alloc_>::diff(a, b);
     }
 }
 #endif
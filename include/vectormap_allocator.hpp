@@ -0,0 +1,213 @@
+#ifndef __VECTORMAPALLOCATOR_H__
+#define __VECTORMAPALLOCATOR_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <limits>
+#include <type_traits>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define VECTORMAP_HUGE_PAGES 1
+#else
+#define VECTORMAP_HUGE_PAGES 0
+#endif
+
+namespace com {
+    /**
+     * @brief Placement of the pages of a buffer among the NUMA nodes.
+     *
+     */
+    enum class numa_policy {
+        /** Default kernel placement: every page goes to the node of the thread that first touches it. */
+        local,
+        /** Pages are spread round-robin over the nodes, so threads on every node share the bandwidth. */
+        interleave,
+        /** Pages are only taken from the nodes of the mask. */
+        bind
+    };
+
+    /**
+     * @brief Configuration of huge_page_allocator. It is a template argument, so every
+     *        combination is a distinct allocator type and all its instances are equal.
+     *
+     */
+    struct huge_page_policy {
+        /** Allocations below this number of bytes use std::allocator. */
+        size_t threshold = size_t(2) << 20;
+        /** Size of a huge page. Mappings are aligned to it and rounded up to a multiple of it. */
+        size_t page_size = size_t(2) << 20;
+        /** Try explicit huge pages (MAP_HUGETLB) from the reserved pool before transparent ones. */
+        bool explicit_pages = false;
+        /** NUMA placement of the mapping. */
+        numa_policy numa = numa_policy::local;
+        /** Bit mask of NUMA nodes for interleave and bind. 0 means all the nodes the process may use. */
+        unsigned long nodes = 0;
+    };
+
+    /** @cond */
+    namespace detail {
+#if VECTORMAP_HUGE_PAGES
+        inline void* map_aligned(size_t length, size_t alignment) {
+            size_t padded = length + alignment;
+            void* raw = ::mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (raw == MAP_FAILED) {
+                return nullptr;
+            }
+
+            // Trim the mapping so it starts at a huge page boundary; otherwise the kernel can only back
+            // the inner aligned part with huge pages.
+            uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+            uintptr_t aligned = (start + alignment - 1) & ~(uintptr_t(alignment) - 1);
+            if (aligned != start) {
+                ::munmap(raw, aligned - start);
+            }
+            size_t tail = (start + padded) - (aligned + length);
+            if (tail != 0) {
+                ::munmap(reinterpret_cast<void*>(aligned + length), tail);
+            }
+            return reinterpret_cast<void*>(aligned);
+        }
+
+        inline void bind_numa(void* p, size_t length, numa_policy numa, unsigned long nodes) {
+#if defined(SYS_mbind) && defined(SYS_get_mempolicy)
+            // Values of <numaif.h>, which would otherwise need libnuma.
+            constexpr int mpol_bind = 2;
+            constexpr int mpol_interleave = 3;
+            constexpr unsigned long mpol_f_mems_allowed = 1 << 2;
+            constexpr unsigned long bits = std::numeric_limits<unsigned long>::digits;
+
+            if (numa == numa_policy::local) {
+                return;
+            }
+            if ((nodes == 0) && (::syscall(SYS_get_mempolicy, nullptr, &nodes, bits, nullptr, mpol_f_mems_allowed) != 0)) {
+                return;
+            }
+
+            // The placement is a hint: on failure, e.g. without NUMA support, the pages stay local.
+            ::syscall(SYS_mbind, p, length, (numa == numa_policy::bind) ? mpol_bind : mpol_interleave, &nodes, bits + 1, 0);
+#else
+            (void)p;
+            (void)length;
+            (void)numa;
+            (void)nodes;
+#endif
+        }
+#endif
+    }
+    /** @endcond */
+
+    /**
+     * @brief Allocator for very large vectormaps. Buffers of policy_.threshold bytes or more are
+     *        mapped aligned to huge pages, backed by explicit or transparent huge pages, and
+     *        optionally interleaved or bound across NUMA nodes. Smaller buffers use std::allocator.\n
+     *        Every reallocation maps new memory, so it pays off for maps that reserve() their final
+     *        size up front or use a large delta_. On systems other than Linux it is std::allocator.
+     *
+     * @tparam T       Type of the elements.
+     * @tparam policy_ Thresholds, page kind and NUMA placement.
+     */
+    template<class T, huge_page_policy policy_ = huge_page_policy{}>
+    class huge_page_allocator {
+        public:
+            /** @cond */
+            using value_type = T;
+            using size_type = size_t;
+            using difference_type = std::ptrdiff_t;
+            using is_always_equal = std::true_type;
+            using propagate_on_container_move_assignment = std::true_type;
+
+            template<class U>
+            struct rebind {
+                using other = huge_page_allocator<U, policy_>;
+            };
+
+            static constexpr huge_page_policy policy = policy_;
+            /** @endcond */
+
+            static_assert((policy_.page_size != 0) && ((policy_.page_size & (policy_.page_size - 1)) == 0), "page_size must be a power of two");
+
+            huge_page_allocator() noexcept = default;
+            template<class U>
+            huge_page_allocator(const huge_page_allocator<U, policy_>&) noexcept {}
+
+            /**
+             * @brief Allocates storage for n elements.
+             *
+             * @param n   Number of elements.
+             * @return T* Pointer to the storage.
+             * @throw std::bad_alloc if the memory cannot be obtained.
+             */
+            T* allocate(size_type n);
+            /**
+             * @brief Releases storage obtained from allocate() with the same n.
+             *
+             */
+            void deallocate(T* p, size_type n) noexcept;
+
+            /**
+             * @brief Whether a buffer of n elements is mapped with huge pages.
+             *
+             */
+            static bool is_huge(size_type n) { return VECTORMAP_HUGE_PAGES && (n * sizeof(T) >= policy_.threshold); }
+
+            friend bool operator==(const huge_page_allocator&, const huge_page_allocator&) { return true; }
+
+        private:
+            static size_type mapped_bytes_(size_type n) { return (n * sizeof(T) + policy_.page_size - 1) & ~(policy_.page_size - 1); }
+    };
+
+    template<class T, huge_page_policy policy_>
+    T* huge_page_allocator<T, policy_>::allocate(size_type n) {
+        if (n > (std::numeric_limits<size_type>::max() - policy_.page_size) / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        if (!is_huge(n)) {
+            return std::allocator<T>().allocate(n);
+        }
+
+#if VECTORMAP_HUGE_PAGES
+        size_type length = mapped_bytes_(n);
+        void* p = nullptr;
+
+        if (policy_.explicit_pages) {
+            p = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p == MAP_FAILED) {
+                p = nullptr;
+            }
+        }
+        if (p == nullptr) {
+            // The huge page pool is empty or disabled: fall back to transparent huge pages.
+            p = detail::map_aligned(length, policy_.page_size);
+            if (p == nullptr) {
+                throw std::bad_alloc();
+            }
+#if defined(MADV_HUGEPAGE)
+            ::madvise(p, length, MADV_HUGEPAGE);
+#endif
+        }
+
+        // The mapping is not touched yet, so no page has been placed before the policy applies.
+        detail::bind_numa(p, length, policy_.numa, policy_.nodes);
+        return static_cast<T*>(p);
+#else
+        return std::allocator<T>().allocate(n);
+#endif
+    }
+
+    template<class T, huge_page_policy policy_>
+    void huge_page_allocator<T, policy_>::deallocate(T* p, size_type n) noexcept {
+        if (!is_huge(n)) {
+            std::allocator<T>().deallocate(p, n);
+            return;
+        }
+#if VECTORMAP_HUGE_PAGES
+        ::munmap(p, mapped_bytes_(n));
+#endif
+    }
+}
+#endif
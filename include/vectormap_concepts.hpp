@@ -0,0 +1,14 @@
+#ifndef __VECTORMAPCONCEPTS_H__
+#define __VECTORMAPCONCEPTS_H__
+
+#include <concepts>
+#include <type_traits>
+
+namespace com {
+    template<class T>
+    concept Keyable = (requires(T a_, T b_) {a_ == b_;}) && (!std::is_integral<T>::value);
+
+    template<class T>
+    concept DefaultInitializableKeyable = Keyable<T> && std::default_initializable<T>;
+}
+#endif
@@ -0,0 +1,234 @@
+#ifndef __VECTORMAPLOADER_H__
+#define __VECTORMAPLOADER_H__
+
+#include "vectormap.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <future>
+#include <thread>
+#include <utility>
+#include <algorithm>
+#include <system_error>
+#include <cerrno>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define VECTORMAP_LOADER_POSIX 1
+#else
+#include <fstream>
+#define VECTORMAP_LOADER_POSIX 0
+#endif
+
+namespace com {
+    /**
+     * @brief Tuning of load() and load_async().
+     *
+     */
+    struct load_options {
+        /** Bytes read from the file at once. Every block is parsed as one task. */
+        size_t block_size = size_t(16) << 20;
+        /** Maximum number of blocks parsed at the same time. 0 uses the hardware threads. */
+        size_t threads = 0;
+    };
+
+    /** @cond */
+    namespace detail {
+        /**
+         * @brief Sequential reader of a file in large blocks.\n
+         *        Uses pread() with a sequential access hint on POSIX systems and std::ifstream elsewhere.
+         *
+         */
+        class block_reader {
+            public:
+                explicit block_reader(const std::string& path) {
+#if VECTORMAP_LOADER_POSIX
+                    fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                    if (fd_ < 0) {
+                        throw std::system_error(errno, std::generic_category(), path);
+                    }
+#if defined(POSIX_FADV_SEQUENTIAL)
+                    ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#else
+                    file_.open(path, std::ios::binary);
+                    if (!file_) {
+                        throw std::system_error(std::make_error_code(std::errc::no_such_file_or_directory), path);
+                    }
+#endif
+                }
+
+                block_reader(const block_reader&) = delete;
+                block_reader& operator=(const block_reader&) = delete;
+
+                ~block_reader() {
+#if VECTORMAP_LOADER_POSIX
+                    ::close(fd_);
+#endif
+                }
+
+                /**
+                 * @brief Appends up to length bytes of the file to buffer.
+                 *
+                 * @return size_t  Number of bytes read; 0 at the end of the file.
+                 */
+                size_t read(std::string& buffer, size_t length) {
+                    size_t start = buffer.size();
+                    buffer.resize(start + length);
+                    size_t done = 0;
+#if VECTORMAP_LOADER_POSIX
+                    while (done < length) {
+                        ssize_t n = ::pread(fd_, buffer.data() + start + done, length - done, offset_);
+                        if (n < 0) {
+                            if (errno == EINTR) {
+                                continue;
+                            }
+                            throw std::system_error(errno, std::generic_category(), "pread");
+                        }
+                        if (n == 0) {
+                            break;
+                        }
+                        done += size_t(n);
+                        offset_ += n;
+                    }
+#else
+                    file_.read(buffer.data() + start, std::streamsize(length));
+                    done = size_t(file_.gcount());
+#endif
+                    buffer.resize(start + done);
+                    return done;
+                }
+
+            private:
+#if VECTORMAP_LOADER_POSIX
+                int fd_ = -1;
+                off_t offset_ = 0;
+#else
+                std::ifstream file_;
+#endif
+        };
+
+        template<class Pair, class Parser>
+        std::vector<Pair> parse_block(const std::string& block, Parser& parser) {
+            std::vector<Pair> out;
+            std::string_view text(block);
+
+            while (!text.empty()) {
+                size_t eol = text.find('\n');
+                std::string_view line = text.substr(0, eol);
+                text.remove_prefix((eol == std::string_view::npos) ? text.size() : eol + 1);
+
+                if (!line.empty() && (line.back() == '\r')) {
+                    line.remove_suffix(1);
+                }
+                if (auto parsed = parser(line)) {
+                    out.emplace_back(std::move(*parsed));
+                }
+            }
+
+            return out;
+        }
+    }
+    /** @endcond */
+
+    /**
+     * @brief Fills a vectormap from a text file, one element per line.\n
+     *        The file is read in blocks cut at line boundaries. While a block is read, the previous
+     *        ones are parsed in parallel; the results are appended in file order after a single reservation.
+     *
+     * @tparam map_     Type of the vectormap to build.
+     * @param path      Path of the file.
+     * @param parser    Called as parser(std::string_view line) for every line, without the line break.
+     *                  Returns an optional pair of key and value; empty optionals are skipped.
+     *                  It is called concurrently from several threads.
+     * @param options   Block size and parallelism.
+     * @return map_     The loaded vectormap.
+     */
+    template<class map_, class Parser>
+        requires std::invocable<Parser&, std::string_view>
+    map_ load(const std::string& path, Parser parser, const load_options& options = {}) {
+        using pair_type = std::pair<typename map_::key_type, typename map_::mapped_type>;
+        using block_result = std::vector<pair_type>;
+
+        size_t threads = (options.threads != 0) ? options.threads : std::max<size_t>(1, std::thread::hardware_concurrency());
+        size_t block_size = std::max<size_t>(options.block_size, 1);
+
+        detail::block_reader reader(path);
+        std::vector<block_result> results;
+        std::deque<std::future<block_result>> pending;
+        std::string carry;
+
+        auto wait_oldest = [&]() {
+            results.push_back(pending.front().get());
+            pending.pop_front();
+        };
+
+        while (true) {
+            std::string block = std::move(carry);
+            carry.clear();
+            size_t read = reader.read(block, block_size);
+
+            if (read != 0) {
+                // The partial last line starts the next block.
+                size_t eol = block.rfind('\n');
+                if (eol == std::string::npos) {
+                    carry = std::move(block);
+                    continue;
+                }
+                carry.assign(block, eol + 1);
+                block.resize(eol + 1);
+            }
+
+            if (!block.empty()) {
+                if (pending.size() >= threads) {
+                    wait_oldest();
+                }
+                pending.push_back(std::async(std::launch::async, [&parser, b = std::move(block)]() {
+                    return detail::parse_block<pair_type>(b, parser);
+                }));
+            }
+
+            if (read == 0) {
+                break;
+            }
+        }
+
+        while (!pending.empty()) {
+            wait_oldest();
+        }
+
+        size_t total = 0;
+        for (const auto& r : results) {
+            total += r.size();
+        }
+
+        map_ out;
+        out.reserve(total);
+        for (auto& r : results) {
+            for (auto& elem : r) {
+                out.emplace_back(std::move(elem.first), std::move(elem.second));
+            }
+            block_result().swap(r);
+        }
+
+        return out;
+    }
+
+    /**
+     * @brief Fills a vectormap from a text file in a background thread. See load().
+     *
+     * @return std::future<map_>  Future with the loaded vectormap, or with the exception thrown while loading.
+     */
+    template<class map_, class Parser>
+        requires std::invocable<Parser&, std::string_view>
+    std::future<map_> load_async(const std::string& path, Parser parser, const load_options& options = {}) {
+        return std::async(std::launch::async, [path, parser = std::move(parser), options]() mutable {
+            return load<map_>(path, parser, options);
+        });
+    }
+}
+#endif
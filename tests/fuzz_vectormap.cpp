@@ -0,0 +1,20 @@
+#include "vectormap_model.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ * @brief libFuzzer entry point: runs the input as a sequence of operations against the reference model
+ *        and aborts on the first difference.
+ *
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    differential::byte_source src(data, size);
+    differential::vectormap_model<3> model;
+    std::string error = model.run(src);
+    if (!error.empty()) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        std::abort();
+    }
+    return 0;
+}
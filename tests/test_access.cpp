@@ -145,3 +145,43 @@ TEST_F(VectorMapTestAccess, GetAllPos) {
     EXPECT_EQ(v.at(1), 4);
     EXPECT_EQ(v.at(2), 7);
 }
+
+TEST_F(VectorMapTestAccess, LookupBatch) {
+    std::vector<std::string> keys = {"Dos", "Nueve", "Ocho", "Cero", "Dos", "Cinco"};
+    std::vector<vmap::size_type> pos(keys.size());
+
+    EXPECT_EQ(n.lookup_batch(keys, pos), 5);
+    EXPECT_EQ(pos, (std::vector<vmap::size_type>{2, vmap::npos, 8, 0, 2, 5}));
+
+    std::vector<size_t*> values(keys.size());
+    EXPECT_EQ(n.lookup_batch(keys, values), 5);
+    ASSERT_NE(values[0], nullptr);
+    EXPECT_EQ(*values[0], 2);
+    EXPECT_EQ(values[1], nullptr);
+    EXPECT_EQ(values[0], values[4]);
+    *values[2] = 80;
+    EXPECT_EQ(n.get_value(8), 80);
+
+    std::vector<vmap::size_type> shorter(2);
+    EXPECT_EQ(n.lookup_batch(keys, shorter), 1);
+    EXPECT_EQ(shorter[1], vmap::npos);
+}
+
+TEST_F(VectorMapTestAccess, LookupBatchManyKeys) {
+    vmap m;
+    for (size_t i = 0; i < 3000; ++i) {
+        m.push_back(std::to_string(i % 2000), i);
+    }
+
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < 2 * vmap::lookup_block + 7; ++i) {
+        keys.push_back(std::to_string((i * 7) % 2500));
+    }
+    std::vector<vmap::size_type> pos(keys.size());
+    m.lookup_batch(keys, pos);
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        std::vector<vmap::size_type> expected = m.get_pos(keys[i]);
+        EXPECT_EQ(pos[i], expected.empty() ? vmap::npos : expected[0]) << keys[i];
+    }
+}
@@ -0,0 +1,83 @@
+#include "vectormap.hpp"
+#include "vectormap_allocator.hpp"
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <string>
+
+using value_type = std::pair<const std::string, size_t>;
+
+constexpr com::huge_page_policy always_huge{.threshold = 1, .page_size = size_t(2) << 20};
+constexpr com::huge_page_policy interleaved{.threshold = 1, .explicit_pages = true, .numa = com::numa_policy::interleave};
+constexpr com::huge_page_policy bound{.threshold = 1, .numa = com::numa_policy::bind, .nodes = 1};
+
+using small_map = com::vectormap<std::string, size_t, 3, com::huge_page_allocator<value_type>>;
+using huge_map = com::vectormap<std::string, size_t, 3, com::huge_page_allocator<value_type, always_huge>>;
+using interleaved_map = com::vectormap<std::string, size_t, 100, com::huge_page_allocator<value_type, interleaved>>;
+using bound_map = com::vectormap<std::string, size_t, 100, com::huge_page_allocator<value_type, bound>>;
+
+template<class map>
+void fill(map& m, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        m.push_back(std::to_string(i), i);
+    }
+}
+
+template<class map>
+void check(const map& m, size_t n) {
+    ASSERT_EQ(m.size(), n);
+    for (size_t i = 0; i < n; ++i) {
+        EXPECT_EQ(m.data()[i].first, std::to_string(i));
+        EXPECT_EQ(m.data()[i].second, i);
+    }
+}
+
+TEST(VectorMapTestAllocator, BelowThreshold) {
+    small_map m;
+    fill(m, 50);
+    check(m, 50);
+    EXPECT_FALSE(small_map::allocator_type::is_huge(m.capacity()));
+}
+
+TEST(VectorMapTestAllocator, HugePages) {
+    huge_map m;
+    fill(m, 50);
+    check(m, 50);
+
+    EXPECT_EQ(huge_map::allocator_type::is_huge(m.capacity()), VECTORMAP_HUGE_PAGES == 1);
+    if (huge_map::allocator_type::is_huge(m.capacity())) {
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(m.data()) % always_huge.page_size, 0);
+    }
+
+    huge_map copy(m);
+    check(copy, 50);
+    huge_map moved(std::move(copy));
+    check(moved, 50);
+
+    m.erase_all("7");
+    m.shrink();
+    EXPECT_EQ(m.size(), 49);
+}
+
+TEST(VectorMapTestAllocator, NumaPlacement) {
+    // Without NUMA support or explicit huge pages the allocator falls back to local transparent huge pages.
+    interleaved_map a;
+    a.reserve(10000);
+    fill(a, 10000);
+    check(a, 10000);
+
+    bound_map b;
+    fill(b, 1000);
+    check(b, 1000);
+}
+
+TEST(VectorMapTestAllocator, Rebind) {
+    using rebound = std::allocator_traits<com::huge_page_allocator<value_type, always_huge>>::rebind_alloc<int>;
+    static_assert(std::is_same_v<rebound, com::huge_page_allocator<int, always_huge>>);
+
+    rebound alloc;
+    int* p = alloc.allocate(10);
+    p[9] = 9;
+    EXPECT_EQ(p[9], 9);
+    alloc.deallocate(p, 10);
+}
@@ -0,0 +1,98 @@
+#include "vectormap.hpp"
+#include "gtest/gtest.h"
+
+#include <random>
+
+using vmap = com::vectormap<std::string, size_t, 3>;
+
+class VectorMapTestBatch : public ::testing::Test {
+    protected:
+        vmap n = {{"Cero", 0}, {"Uno", 1}, {"Dos", 2}, {"Tres", 3}, {"Cuatro", 4}, {"Cinco", 5}, {"Seis", 6}, {"Siete", 7}, {"Ocho", 8}};
+};
+
+TEST_F(VectorMapTestBatch, PendingState) {
+    vmap::batch b(n);
+
+    EXPECT_FALSE(b.is_pending());
+    EXPECT_TRUE(b.insert("Nueve", 9, 3));
+    EXPECT_TRUE(b.erase(0));
+    EXPECT_TRUE(b.insert("Diez", 10, 0));
+    EXPECT_FALSE(b.insert("Once", 11, 20));
+    EXPECT_FALSE(b.erase(20));
+
+    EXPECT_TRUE(b.is_pending());
+    ASSERT_EQ(b.size(), 10);
+    EXPECT_EQ(b.get(0)->first, "Diez");
+    EXPECT_EQ(b.get(1)->first, "Uno");
+    EXPECT_EQ(b.get(3)->first, "Nueve");
+    EXPECT_EQ(b.get(4)->first, "Tres");
+    EXPECT_EQ(b.get(10), nullptr);
+
+    ASSERT_EQ(n.size(), 9);
+    EXPECT_EQ(n.get_key(0), "Cero");
+}
+
+TEST_F(VectorMapTestBatch, Commit) {
+    vmap::batch b(n);
+    b.erase(8);
+    b.push_back({"Nueve", 9});
+    b.push_back({"Diez", 10});
+    b.erase(4);
+    b.insert("Cuatro", 40, 4);
+    b.commit();
+
+    EXPECT_FALSE(b.is_pending());
+    ASSERT_EQ(n.size(), 10);
+    EXPECT_EQ(n.capacity(), 12);
+    EXPECT_EQ(n.get_key(4), "Cuatro");
+    EXPECT_EQ(n.get_value(4), 40);
+    EXPECT_EQ(n.get_key(7), "Siete");
+    EXPECT_EQ(n.get_key(8), "Nueve");
+    EXPECT_EQ(n.get_key(9), "Diez");
+}
+
+TEST_F(VectorMapTestBatch, Discard) {
+    vmap::batch b(n);
+    b.erase(0);
+    b.insert("Nueve", 9, 2);
+    b.discard();
+    b.commit();
+
+    ASSERT_EQ(n.size(), 9);
+    EXPECT_EQ(n.get_key(0), "Cero");
+    EXPECT_EQ(n.get_key(2), "Dos");
+}
+
+TEST_F(VectorMapTestBatch, RandomEdits) {
+    std::vector<std::pair<std::string, size_t>> model;
+    for (auto& elem : n) {
+        model.emplace_back(elem.first, elem.second);
+    }
+
+    std::mt19937 gen(42);
+    vmap::batch b(n);
+    for (size_t i = 0; i < 500; ++i) {
+        if ((gen() % 3 != 0) || model.empty()) {
+            size_t pos = gen() % (model.size() + 1);
+            b.insert(std::to_string(i), i, pos);
+            model.insert(model.begin() + pos, std::make_pair(std::to_string(i), i));
+        }
+        else {
+            size_t pos = gen() % model.size();
+            b.erase(pos);
+            model.erase(model.begin() + pos);
+        }
+
+        size_t probe = gen() % (model.size() + 1);
+        if (probe < model.size()) {
+            ASSERT_EQ(b.get(probe)->first, model[probe].first);
+        }
+    }
+    b.commit();
+
+    ASSERT_EQ(n.size(), model.size());
+    for (size_t i = 0; i < model.size(); ++i) {
+        EXPECT_EQ(n.get_key(i), model[i].first);
+        EXPECT_EQ(n.get_value(i), model[i].second);
+    }
+}
@@ -0,0 +1,147 @@
+#include "compressed_vectormap.hpp"
+#include "gtest/gtest.h"
+
+#include <random>
+#include <string>
+
+using vmap = com::vectormap<std::string, size_t, 3>;
+using cmap = com::compressed_vectormap<std::string, size_t, 8>;
+
+class CompressedVectorMapTest : public ::testing::Test {
+    protected:
+        cmap n = {{"Cero", 0}, {"Uno", 1}, {"Dos", 2}, {"Tres", 3}, {"Dos", 4}, {"Cinco", 5}, {"Seis", 6}, {"Dos", 7}, {"Ocho", 8}};
+};
+
+TEST_F(CompressedVectorMapTest, Access) {
+    ASSERT_EQ(n.size(), 9);
+    for (size_t i = 0; i < n.size(); ++i) {
+        EXPECT_EQ(n.get_value(i), i);
+    }
+    EXPECT_EQ(n.get_value(9), 0);
+    EXPECT_EQ(n.get_key(5), "Cinco");
+    EXPECT_EQ(n.get_key(9), "");
+    EXPECT_EQ(n.get_pos("Dos", 3), 7);
+    EXPECT_EQ(n.get_pos("Dos", 4), cmap::npos);
+    EXPECT_EQ(n.get_value("Seis"), 6);
+    EXPECT_TRUE(n.contains("Ocho"));
+    EXPECT_FALSE(n.contains("Nueve"));
+}
+
+TEST_F(CompressedVectorMapTest, SetValue) {
+    n.set_value(1000000, 3);
+    n.set_value(7, "Dos", 2);
+    n.set_value(5, 0);
+    EXPECT_EQ(n.get_value(3), 1000000);
+    EXPECT_EQ(n.get_value(4), 7);
+    EXPECT_EQ(n.get_value(0), 5);
+    EXPECT_EQ(n.get_value(8), 8);
+    EXPECT_EQ(n.get_value(1), 1);
+}
+
+TEST_F(CompressedVectorMapTest, DecodeAndIterate) {
+    std::vector<size_t> values(20, 99);
+    EXPECT_EQ(n.decode(2, values), 7);
+    for (size_t i = 0; i < 7; ++i) {
+        EXPECT_EQ(values[i], i + 2);
+    }
+    EXPECT_EQ(values[7], 99);
+    EXPECT_EQ(n.decode(9, values), 0);
+
+    size_t i = 0;
+    n.for_each([&](const std::string& key, size_t val) {
+        EXPECT_EQ(key, n.get_key(i));
+        EXPECT_EQ(val, i);
+        ++i;
+    });
+    EXPECT_EQ(i, 9);
+
+    vmap m = n.decompress<3>();
+    ASSERT_EQ(m.size(), 9);
+    EXPECT_EQ(m.get(3)->first, "Tres");
+    EXPECT_EQ(m.get_value(8), 8);
+}
+
+TEST(CompressedVectorMapTestRandom, ReencodeMiddleBlock) {
+    cmap c;
+    for (size_t i = 0; i < 40; ++i) {
+        c.push_back(std::to_string(i), i % 4);
+    }
+    size_t bytes = c.value_bytes();
+
+    // Widening block 2 leaves blocks 1 and 3 as they were.
+    c.set_value(size_t(1) << 40, 18);
+    for (size_t i = 0; i < 40; ++i) {
+        EXPECT_EQ(c.get_value(i), (i == 18) ? size_t(1) << 40 : i % 4) << i;
+    }
+
+    // Repeated widening and narrowing of the middle blocks does not let the left behind words pile up.
+    for (size_t round = 0; round < 200; ++round) {
+        size_t pos = 8 + (round * 7) % 24;
+        c.set_value((round % 2 == 0) ? (size_t(1) << (20 + round % 40)) : pos % 4, pos);
+    }
+    for (size_t round = 0; round < 200; ++round) {
+        size_t pos = 8 + (round * 7) % 24;
+        c.set_value(pos % 4, pos);
+    }
+    std::vector<size_t> decoded(40);
+    ASSERT_EQ(c.decode(0, decoded), 40);
+    for (size_t i = 0; i < 40; ++i) {
+        EXPECT_EQ(c.get_value(i), i % 4) << i;
+        EXPECT_EQ(decoded[i], i % 4) << i;
+    }
+    EXPECT_LE(c.value_bytes(), 3 * bytes);
+}
+
+TEST(CompressedVectorMapTestRandom, MatchesVectormap) {
+    std::mt19937_64 rng(7);
+    vmap source;
+    for (size_t i = 0; i < 3000; ++i) {
+        // Mostly small counters with some wide outliers.
+        size_t val = (rng() % 50 == 0) ? rng() : rng() % 1000;
+        source.push_back(std::to_string(i), val);
+    }
+
+    com::compressed_vectormap<std::string, size_t> c(source);
+    cmap appended;
+    for (size_t i = 0; i < source.size(); ++i) {
+        appended.push_back(source.get_key(i), source.get_value(i));
+    }
+
+    for (size_t round = 0; round < 500; ++round) {
+        size_t pos = rng() % source.size();
+        size_t val = (round % 3 == 0) ? rng() : rng() % 100;
+        source.set_value(val, pos);
+        c.set_value(val, pos);
+        appended.set_value(val, pos);
+    }
+
+    std::vector<size_t> decoded(source.size());
+    ASSERT_EQ(c.decode(0, decoded), source.size());
+    for (size_t i = 0; i < source.size(); ++i) {
+        ASSERT_EQ(c.get_value(i), source.get_value(i)) << i;
+        ASSERT_EQ(appended.get_value(i), source.get_value(i)) << i;
+        ASSERT_EQ(decoded[i], source.get_value(i)) << i;
+    }
+}
+
+TEST(CompressedVectorMapTestRandom, SignedValues) {
+    com::compressed_vectormap<std::string, int, 4> c = {{"a", -5}, {"b", 3}, {"c", std::numeric_limits<int>::min()}, {"d", 0}, {"e", -1}};
+    EXPECT_EQ(c.get_value(0), -5);
+    EXPECT_EQ(c.get_value(2), std::numeric_limits<int>::min());
+    c.set_value(std::numeric_limits<int>::max(), 1);
+    EXPECT_EQ(c.get_value(1), std::numeric_limits<int>::max());
+    EXPECT_EQ(c.get_value(3), 0);
+    EXPECT_EQ(c.get_value(4), -1);
+}
+
+TEST(CompressedVectorMapTestRandom, MemoryUsage) {
+    vmap source;
+    for (size_t i = 0; i < 10000; ++i) {
+        source.push_back("k", i % 256);
+    }
+    com::compressed_vectormap<std::string, size_t> c(source);
+
+    // 8 bits per value plus a block header every 128 values, against 64 bits.
+    EXPECT_LT(c.value_bytes() * 6, source.size() * sizeof(size_t));
+    EXPECT_EQ(c.memory_usage().used_bytes, source.size() * sizeof(std::string) + c.value_bytes());
+}
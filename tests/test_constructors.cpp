@@ -60,3 +60,32 @@ TEST_F(VectorMapTestConstructors, MoveConstructor) {
     EXPECT_EQ(q.capacity(), 0);
     EXPECT_EQ(q.data(), nullptr);
 }
+
+TEST(VectorMapTestParallel, CopyResizeDestroy) {
+    vmap big;
+    big.reserve(10000);
+    for (size_t i = 0; i < 10000; ++i) {
+        big.push_back(std::string(20, 'a') + std::to_string(i), i);
+    }
+    big.set_parallel_threshold(1000, 4);
+
+    vmap copy(big);
+    ASSERT_EQ(copy.size(), 10000);
+    EXPECT_EQ(copy.parallel_threshold(), 1000);
+    for (size_t i = 0; i < copy.size(); ++i) {
+        ASSERT_EQ(copy.data()[i].second, i);
+        ASSERT_EQ(copy.data()[i].first, big.data()[i].first);
+    }
+
+    vmap assigned = {{"Cero", 0}};
+    assigned = copy;
+    EXPECT_EQ(assigned.size(), 10000);
+    EXPECT_EQ(assigned.get_key(9999), big.get_key(9999));
+
+    EXPECT_TRUE(copy.resize(30000));
+    EXPECT_EQ(copy.capacity(), 30000);
+    EXPECT_EQ(copy.get_key(5000), big.get_key(5000));
+
+    copy.clear();
+    EXPECT_EQ(copy.size(), 0);
+}
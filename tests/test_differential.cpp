@@ -0,0 +1,31 @@
+#include "vectormap_model.hpp"
+#include "gtest/gtest.h"
+
+#include <random>
+
+template<class T>
+class VectorMapTestDifferential : public ::testing::Test {};
+
+using deltas = ::testing::Types<differential::vectormap_model<1>, differential::vectormap_model<3>, differential::vectormap_model<100>>;
+TYPED_TEST_SUITE(VectorMapTestDifferential, deltas);
+
+TYPED_TEST(VectorMapTestDifferential, RandomOperations) {
+    for (uint32_t seed = 0; seed < 200; ++seed) {
+        std::mt19937 rng(seed);
+        std::vector<uint8_t> bytes(1500);
+        for (auto& b : bytes) {
+            b = uint8_t(rng());
+        }
+
+        differential::byte_source src(bytes.data(), bytes.size());
+        TypeParam model;
+        std::string error = model.run(src);
+        ASSERT_TRUE(error.empty()) << "seed " << seed << ": " << error;
+    }
+}
+
+TYPED_TEST(VectorMapTestDifferential, EmptyInput) {
+    differential::byte_source src(nullptr, 0);
+    TypeParam model;
+    EXPECT_TRUE(model.run(src).empty());
+}
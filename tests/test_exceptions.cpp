@@ -0,0 +1,319 @@
+#include "vectormap.hpp"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace {
+    // Number of allocations that succeed before the next one throws; negative never throws.
+    int allocations_left = -1;
+    // Number of copies that succeed before the next one throws; negative never throws.
+    std::atomic<int> copies_left = -1;
+
+    template<class T>
+    struct throwing_allocator {
+        using value_type = T;
+
+        throwing_allocator() = default;
+        template<class U>
+        throwing_allocator(const throwing_allocator<U>&) {}
+
+        T* allocate(size_t n) {
+            if ((allocations_left >= 0) && (allocations_left-- == 0)) {
+                throw std::bad_alloc();
+            }
+            return std::allocator<T>().allocate(n);
+        }
+        void deallocate(T* p, size_t n) { std::allocator<T>().deallocate(p, n); }
+
+        bool operator==(const throwing_allocator&) const { return true; }
+    };
+
+    struct fragile {
+        size_t value = 0;
+
+        fragile() = default;
+        fragile(size_t v) : value(v) {}
+        fragile(const fragile& other) : value(other.value) {
+            if ((copies_left >= 0) && (copies_left-- == 0)) {
+                throw std::runtime_error("copy");
+            }
+        }
+        fragile(fragile&& other) noexcept : value(other.value) {}
+        fragile& operator=(const fragile& other) = default;
+    };
+
+    // Number of moves that succeed before the next failing_moves ones throw; negative never throws.
+    int moves_left = -1;
+    int failing_moves = 0;
+
+    struct brittle {
+        size_t value = 0;
+
+        brittle() = default;
+        brittle(size_t v) : value(v) {}
+        brittle(const brittle& other) = default;
+        brittle(brittle&& other) : value(other.value) {
+            if (moves_left > 0) {
+                --moves_left;
+            }
+            else if ((moves_left == 0) && (failing_moves-- > 0)) {
+                throw std::runtime_error("move");
+            }
+        }
+    };
+}
+
+// std::string_view keys make value_type nothrow movable; const std::string keys are copied when moved.
+template<class key>
+using fmap = com::vectormap<key, fragile, 3, throwing_allocator<std::pair<const key, fragile>>>;
+
+template<class map>
+class VectorMapTestExceptions : public ::testing::Test {
+    protected:
+        map n = {{"Cero", 0}, {"Uno", 1}, {"Dos", 2}, {"Tres", 3}, {"Cuatro", 4}, {"Cinco", 5}, {"Seis", 6}, {"Siete", 7}, {"Ocho", 8}};
+
+        void TearDown() override {
+            allocations_left = -1;
+            copies_left = -1;
+        }
+
+        void expect_unchanged(map& m) {
+            const char* keys[] = {"Cero", "Uno", "Dos", "Tres", "Cuatro", "Cinco", "Seis", "Siete", "Ocho"};
+            ASSERT_EQ(m.size(), 9);
+            EXPECT_EQ(m.capacity(), 12);
+            for (size_t i = 0; i < 9; ++i) {
+                EXPECT_EQ(m.get_key(i), keys[i]);
+                EXPECT_EQ(m.get_value(i).value, i);
+            }
+        }
+};
+
+using maps = ::testing::Types<fmap<std::string_view>, fmap<std::string>>;
+TYPED_TEST_SUITE(VectorMapTestExceptions, maps);
+
+TYPED_TEST(VectorMapTestExceptions, InsertThrowingCopy) {
+    copies_left = 1;
+    EXPECT_THROW(this->n.insert({{"Nueve", 9}, {"Diez", 10}, {"Once", 11}}, 3), std::runtime_error);
+    this->expect_unchanged(this->n);
+
+    copies_left = 0;
+    EXPECT_THROW(this->n.push_front({"Nueve", 9}), std::runtime_error);
+    this->expect_unchanged(this->n);
+}
+
+TYPED_TEST(VectorMapTestExceptions, GrowthThrowingCopy) {
+    copies_left = 3;
+    EXPECT_THROW(this->n.push_back({{"Nueve", 9}, {"Diez", 10}, {"Once", 11}, {"Doce", 12}}), std::runtime_error);
+    this->expect_unchanged(this->n);
+
+    copies_left = 4;
+    if constexpr (std::is_nothrow_move_constructible_v<typename TypeParam::value_type>) {
+        // Growing moves the current elements, so only the four new ones are copied.
+        this->n.push_back({{"Nueve", 9}, {"Diez", 10}, {"Once", 11}, {"Doce", 12}});
+        ASSERT_EQ(this->n.size(), 13);
+        EXPECT_EQ(this->n.get_key(12), "Doce");
+    }
+    else {
+        EXPECT_THROW(this->n.push_back({{"Nueve", 9}, {"Diez", 10}, {"Once", 11}, {"Doce", 12}}), std::runtime_error);
+        this->expect_unchanged(this->n);
+    }
+}
+
+TYPED_TEST(VectorMapTestExceptions, AllocationFailure) {
+    allocations_left = 0;
+    EXPECT_THROW(this->n.insert({{"Nueve", 9}, {"Diez", 10}, {"Once", 11}, {"Doce", 12}}, 3), std::bad_alloc);
+    this->expect_unchanged(this->n);
+
+    allocations_left = 0;
+    EXPECT_THROW(this->n.reserve(100), std::bad_alloc);
+    this->expect_unchanged(this->n);
+}
+
+TYPED_TEST(VectorMapTestExceptions, TryInsert) {
+    EXPECT_EQ(this->n.try_insert({"Nueve", 9}, 10), std::errc::result_out_of_range);
+
+    allocations_left = 0;
+    EXPECT_FALSE(this->n.try_push_back({"Nueve", 9}));
+    EXPECT_FALSE(this->n.try_push_back({"Diez", 10}));
+    EXPECT_FALSE(this->n.try_push_back({"Once", 11}));
+    EXPECT_EQ(this->n.try_insert({"Doce", 12}, 4), std::errc::not_enough_memory);
+    ASSERT_EQ(this->n.size(), 12);
+    EXPECT_EQ(this->n.get_key(4), "Cuatro");
+    EXPECT_EQ(this->n.get_key(11), "Once");
+
+    EXPECT_FALSE(this->n.try_insert({"Doce", 12}, 4));
+    ASSERT_EQ(this->n.size(), 13);
+    EXPECT_EQ(this->n.get_key(4), "Doce");
+    EXPECT_EQ(this->n.get_key(12), "Once");
+}
+
+TYPED_TEST(VectorMapTestExceptions, TryReserve) {
+    EXPECT_EQ(this->n.try_reserve(2), std::errc::invalid_argument);
+    EXPECT_EQ(this->n.try_reserve(this->n.max_size()), std::errc::value_too_large);
+
+    allocations_left = 0;
+    EXPECT_EQ(this->n.try_reserve(100), std::errc::not_enough_memory);
+    this->expect_unchanged(this->n);
+
+    EXPECT_FALSE(this->n.try_reserve(100));
+    EXPECT_EQ(this->n.capacity(), 102);
+}
+
+TYPED_TEST(VectorMapTestExceptions, CopyThrowing) {
+    com::memory_registry& registry = com::memory_registry::instance();
+    size_t maps = registry.live_maps();
+    size_t bytes = registry.buffer_bytes();
+
+    copies_left = 4;
+    EXPECT_THROW(TypeParam copy(this->n), std::runtime_error);
+    EXPECT_EQ(registry.live_maps(), maps);
+    EXPECT_EQ(registry.buffer_bytes(), bytes);
+
+    TypeParam other = {{"Nueve", 9}};
+    copies_left = 4;
+    EXPECT_THROW(other = this->n, std::runtime_error);
+    ASSERT_EQ(other.size(), 1);
+    EXPECT_EQ(other.get_key(0), "Nueve");
+
+    copies_left = -1;
+    other = this->n;
+    this->expect_unchanged(other);
+}
+
+TYPED_TEST(VectorMapTestExceptions, ParallelCopyThrowing) {
+    com::memory_registry& registry = com::memory_registry::instance();
+    size_t bytes = registry.buffer_bytes();
+    this->n.set_parallel_threshold(1, 4);
+
+    copies_left = 5;
+    EXPECT_THROW(TypeParam copy(this->n), std::runtime_error);
+    EXPECT_EQ(registry.buffer_bytes(), bytes);
+
+    copies_left = 5;
+    if constexpr (!std::is_nothrow_move_constructible_v<typename TypeParam::value_type>) {
+        EXPECT_THROW(this->n.reserve(20), std::runtime_error);
+    }
+    this->expect_unchanged(this->n);
+
+    copies_left = -1;
+    TypeParam copy(this->n);
+    EXPECT_EQ(copy.parallel_threshold(), 1);
+    this->expect_unchanged(copy);
+}
+
+TYPED_TEST(VectorMapTestExceptions, ApplyThrowing) {
+    com::memory_registry& registry = com::memory_registry::instance();
+    size_t bytes = registry.buffer_bytes();
+    typename TypeParam::patch p = {{com::edit_kind::removed, "Cero", 0, 0},
+                                   {com::edit_kind::moved, "Ocho", 8, 8, 1},
+                                   {com::edit_kind::added, "Nueve", 9, TypeParam::npos, 3},
+                                   {com::edit_kind::changed, "Dos", 20, 2}};
+
+    // Every copy made by apply() fails in turn until the whole script goes through.
+    for (int copies = 0;; ++copies) {
+        copies_left = copies;
+        try {
+            ASSERT_TRUE(this->n.apply(p));
+            break;
+        }
+        catch (const std::runtime_error&) {
+            this->expect_unchanged(this->n);
+            EXPECT_EQ(registry.buffer_bytes(), bytes);
+        }
+    }
+
+    copies_left = -1;
+    const char* keys[] = {"Uno", "Ocho", "Dos", "Nueve", "Tres", "Cuatro", "Cinco", "Seis", "Siete"};
+    size_t values[] = {1, 8, 20, 9, 3, 4, 5, 6, 7};
+    ASSERT_EQ(this->n.size(), 9);
+    for (size_t i = 0; i < 9; ++i) {
+        EXPECT_EQ(this->n.get_key(i), keys[i]);
+        EXPECT_EQ(this->n.get_value(i).value, values[i]);
+    }
+}
+
+TYPED_TEST(VectorMapTestExceptions, BatchCommitThrowing) {
+    com::memory_registry& registry = com::memory_registry::instance();
+    size_t bytes = registry.buffer_bytes();
+    typename TypeParam::batch b(this->n);
+    b.insert({"Nueve", 9}, 2);
+    b.erase(0);
+    b.push_back({"Diez", 10});
+
+    for (int copies = 0;; ++copies) {
+        copies_left = copies;
+        try {
+            b.commit();
+            break;
+        }
+        catch (const std::runtime_error&) {
+            this->expect_unchanged(this->n);
+            EXPECT_EQ(registry.buffer_bytes(), bytes);
+            ASSERT_TRUE(b.is_pending());
+            EXPECT_EQ(b.get(1)->first, "Nueve");
+            EXPECT_EQ(b.get(9)->second.value, 10);
+        }
+    }
+
+    copies_left = -1;
+    const char* keys[] = {"Uno", "Nueve", "Dos", "Tres", "Cuatro", "Cinco", "Seis", "Siete", "Ocho", "Diez"};
+    size_t values[] = {1, 9, 2, 3, 4, 5, 6, 7, 8, 10};
+    ASSERT_EQ(this->n.size(), 10);
+    for (size_t i = 0; i < 10; ++i) {
+        EXPECT_EQ(this->n.get_key(i), keys[i]);
+        EXPECT_EQ(this->n.get_value(i).value, values[i]);
+    }
+}
+
+TYPED_TEST(VectorMapTestExceptions, ShrinkThrowing) {
+    this->n.set_shrink_policy(1);
+    EXPECT_EQ(this->n.capacity(), 12);
+
+    // A failed shrink keeps the current buffer and does not undo the erasure.
+    copies_left = 0;
+    EXPECT_NO_THROW(this->n.erase(8));
+    EXPECT_EQ(this->n.size(), 8);
+    allocations_left = 0;
+    EXPECT_NO_THROW(this->n.erase(7));
+    EXPECT_EQ(this->n.size(), 7);
+    EXPECT_EQ(this->n.get_key(6), "Seis");
+}
+
+TEST(VectorMapTestExceptionsBasic, InsertThrowingShift) {
+    // Elements whose move throws are shifted in place: a failure keeps the elements before the
+    // insertion point and leaves a usable vectormap.
+    com::vectormap<std::string_view, brittle, 10> m = {{"Cero", 0}, {"Uno", 1}, {"Dos", 2}, {"Tres", 3}, {"Cuatro", 4}, {"Cinco", 5}};
+    auto h = m.make_handle(1);
+    auto last = m.make_handle(5);
+
+    // The first move back fails too, so the elements after the point of failure are dropped.
+    moves_left = 2;
+    failing_moves = 2;
+    EXPECT_THROW(m.emplace(2, "Seis", 6), std::runtime_error);
+    moves_left = -1;
+    ASSERT_GE(m.size(), 2);
+    ASSERT_LT(m.size(), 6);
+    for (size_t i = 0; i < m.size(); ++i) {
+        EXPECT_EQ(m.get_value(i).value, i);
+    }
+    EXPECT_EQ(m.position(h), 1);
+    EXPECT_EQ(m.position(last), m.npos);
+
+    m.insert({"Seis", 6}, 1);
+    EXPECT_EQ(m.get_value(1).value, 6);
+    EXPECT_EQ(m.position(h), 2);
+
+    // A single failed move is undone.
+    com::vectormap<std::string_view, brittle, 10> n = {{"Cero", 0}, {"Uno", 1}, {"Dos", 2}};
+    moves_left = 1;
+    failing_moves = 1;
+    EXPECT_THROW(n.insert({"Tres", 3}, 0), std::runtime_error);
+    moves_left = -1;
+    ASSERT_EQ(n.size(), 3);
+    for (size_t i = 0; i < 3; ++i) {
+        EXPECT_EQ(n.get_value(i).value, i);
+    }
+}
@@ -0,0 +1,164 @@
+#include "vectormap.hpp"
+#include "gtest/gtest.h"
+
+#include <string>
+
+using vmap = com::vectormap<std::string, size_t, 3>;
+
+class VectorMapTestHandles : public ::testing::Test {
+    protected:
+        vmap n = {{"Cero", 0}, {"Uno", 1}, {"Dos", 2}, {"Tres", 3}, {"Cuatro", 4}, {"Cinco", 5}, {"Seis", 6}, {"Siete", 7}, {"Ocho", 8}};
+        vmap::handle h[9];
+
+        void SetUp() override {
+            for (size_t i = 0; i < 9; ++i) {
+                h[i] = n.make_handle(i);
+            }
+        }
+
+        // Every live handle still resolves to the element it was made for.
+        void expect_resolved() {
+            for (size_t i = 0; i < 9; ++i) {
+                if (n.is_valid(h[i])) {
+                    ASSERT_LT(n.position(h[i]), n.size());
+                    EXPECT_EQ(n.get(h[i])->second, i);
+                }
+            }
+        }
+};
+
+TEST_F(VectorMapTestHandles, MakeHandle) {
+    EXPECT_EQ(n.make_handle(3), h[3]);
+    EXPECT_EQ(n.position(h[3]), 3);
+    EXPECT_EQ(n.get(h[3])->first, "Tres");
+
+    vmap::handle none = n.make_handle(9);
+    EXPECT_EQ(none, vmap::handle());
+    EXPECT_FALSE(n.is_valid(none));
+    EXPECT_EQ(n.position(none), vmap::npos);
+    EXPECT_EQ(n.get(none), n.end());
+}
+
+TEST_F(VectorMapTestHandles, InsertAndErase) {
+    n.push_front("Menos", 100);
+    n.insert({{"A", 101}, {"B", 102}}, 5);
+    EXPECT_EQ(n.position(h[0]), 1);
+    EXPECT_EQ(n.position(h[4]), 7);
+    expect_resolved();
+
+    n.erase(1);
+    n.erase("Tres");
+    EXPECT_FALSE(n.is_valid(h[0]));
+    EXPECT_FALSE(n.is_valid(h[3]));
+    EXPECT_EQ(n.get(h[0]), n.end());
+    EXPECT_EQ(n.position(h[1]), 1);
+    expect_resolved();
+
+    n.erase_all("Ocho");
+    EXPECT_FALSE(n.is_valid(h[8]));
+    expect_resolved();
+}
+
+TEST_F(VectorMapTestHandles, Reallocation) {
+    size_t capacity = n.capacity();
+    for (size_t i = 0; i < 50; ++i) {
+        n.push_front(std::to_string(i), 100 + i);
+    }
+    EXPECT_GT(n.capacity(), capacity);
+    n.shrink();
+    EXPECT_EQ(n.position(h[0]), 50);
+    expect_resolved();
+}
+
+TEST_F(VectorMapTestHandles, MoveAndSwap) {
+    n.move(1, 6);
+    n.move(7, 0);
+    n.swap(2, 8);
+    expect_resolved();
+    EXPECT_EQ(n.position(h[7]), 0);
+}
+
+TEST_F(VectorMapTestHandles, Reordering) {
+    n.sort_by(&vmap::value_type::first);
+    expect_resolved();
+    EXPECT_EQ(n.position(h[5]), 1);
+
+    n.push_back("Dos", 20);
+    n.group_by_key();
+    expect_resolved();
+
+    n.dedupe_keys(com::dedupe_policy::keep_last);
+    EXPECT_FALSE(n.is_valid(h[2]));
+    expect_resolved();
+
+    n.intersect({{"Uno", 0}, {"Seis", 0}});
+    EXPECT_EQ(n.size(), 2);
+    EXPECT_TRUE(n.is_valid(h[1]));
+    EXPECT_TRUE(n.is_valid(h[6]));
+    EXPECT_FALSE(n.is_valid(h[0]));
+    expect_resolved();
+}
+
+TEST_F(VectorMapTestHandles, BatchApplyMerge) {
+    vmap::batch b(n);
+    b.erase(0);
+    b.insert("Nueve", 9, 4);
+    b.commit();
+    EXPECT_FALSE(n.is_valid(h[0]));
+    EXPECT_EQ(n.position(h[4]), 3);
+    expect_resolved();
+
+    vmap target = n;
+    target.erase(2);
+    target.move(0, 5);
+    target.push_back("Diez", 10);
+    EXPECT_TRUE(n.apply(vmap::diff(n, target)));
+    expect_resolved();
+
+    n.merge({{"Once", 11}, {"Uno", 1}}, com::merge_policy::keep_both);
+    n.merge({{"Doce", 12}});
+    expect_resolved();
+    EXPECT_EQ(n.size(), target.size() + 3);
+}
+
+TEST_F(VectorMapTestHandles, MemoryUsage) {
+    // The keys fit in the small string buffer: only the handle tables own heap memory.
+    vmap m = {{"Cero", 0}, {"Uno", 1}};
+    EXPECT_EQ(m.memory_usage().heap_bytes, 0);
+
+    m.make_handle(1);
+    EXPECT_GE(m.memory_usage().heap_bytes, 2 * sizeof(uint32_t) + sizeof(size_t));
+    EXPECT_GE(n.memory_usage().heap_bytes, 9 * (2 * sizeof(uint32_t) + sizeof(size_t)));
+}
+
+TEST_F(VectorMapTestHandles, ReleaseAndReuse) {
+    n.release(h[2]);
+    EXPECT_FALSE(n.is_valid(h[2]));
+    EXPECT_EQ(n.get(2)->first, "Dos");
+
+    vmap::handle again = n.make_handle(2);
+    EXPECT_NE(again, h[2]);
+    EXPECT_EQ(again.slot, h[2].slot);
+    EXPECT_EQ(n.position(again), 2);
+
+    n.clear();
+    EXPECT_FALSE(n.is_valid(again));
+    n.push_back("Cero", 0);
+    EXPECT_FALSE(n.is_valid(h[0]));
+}
+
+TEST_F(VectorMapTestHandles, CopyAndMove) {
+    vmap copy = n;
+    copy.erase(0);
+    EXPECT_EQ(copy.position(h[1]), 0);
+    EXPECT_EQ(n.position(h[1]), 1);
+
+    vmap moved = std::move(copy);
+    EXPECT_EQ(moved.position(h[1]), 0);
+    EXPECT_FALSE(moved.is_valid(h[0]));
+
+    vmap other = {{"X", 0}};
+    other.swap(other, n);
+    EXPECT_EQ(other.position(h[8]), 8);
+    EXPECT_FALSE(n.is_valid(h[8]));
+}
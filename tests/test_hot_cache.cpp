@@ -0,0 +1,145 @@
+#include "vectormap.hpp"
+#include "gtest/gtest.h"
+
+#include <string>
+
+using vmap = com::vectormap<std::string, size_t, 3>;
+
+class VectorMapTestHotCache : public ::testing::Test {
+    protected:
+        vmap n = {{"Cero", 0}, {"Uno", 1}, {"Dos", 2}, {"Uno", 10}, {"Tres", 3}, {"Uno", 11}, {"Cuatro", 4}};
+
+        void SetUp() override {
+            n.set_hot_cache(2);
+        }
+};
+
+TEST_F(VectorMapTestHotCache, Disabled) {
+    vmap m = {{"Cero", 0}, {"Uno", 1}};
+    EXPECT_EQ(m.hot_cache(), 0);
+    EXPECT_EQ(m.get_value("Uno")[0], 1);
+    EXPECT_EQ(m.get_hot_cache_stats().hits, 0);
+    EXPECT_EQ(m.get_hot_cache_stats().misses, 0);
+}
+
+TEST_F(VectorMapTestHotCache, Hits) {
+    EXPECT_EQ(n.hot_cache(), 2);
+    EXPECT_EQ(n.get_pos("Tres")[0], 4);
+    EXPECT_EQ(n.get_hot_cache_stats().misses, 1);
+    EXPECT_EQ(n.get_pos("Tres")[0], 4);
+    EXPECT_EQ(n.get_value("Tres")[0], 3);
+    EXPECT_EQ(n.get_hot_cache_stats().hits, 2);
+
+    // Absent keys are never cached.
+    EXPECT_TRUE(n.get_pos("Nueve").empty());
+    EXPECT_TRUE(n.get_pos("Nueve").empty());
+    EXPECT_EQ(n.get_hot_cache_stats().misses, 3);
+}
+
+TEST_F(VectorMapTestHotCache, Duplicates) {
+    EXPECT_EQ(n.get_pos("Uno"), std::vector<size_t>({1}));
+    EXPECT_EQ(n.get_pos("Uno", 2), std::vector<size_t>({3}));
+    EXPECT_EQ(n.get_pos("Uno", 1, 3), std::vector<size_t>({1, 3, 5}));
+    EXPECT_EQ(n.get_value("Uno", 2, 2), std::vector<size_t>({10, 11}));
+    EXPECT_TRUE(n.get_pos("Uno", 4).empty());
+    EXPECT_EQ(n.get_hot_cache_stats().hits, 4);
+}
+
+TEST_F(VectorMapTestHotCache, Invalidation) {
+    n.get_pos("Tres");
+    n.get_pos("Uno");
+
+    // Appending keeps the positions.
+    n.push_back({"Tres", 30});
+    EXPECT_EQ(n.get_pos("Tres", 1, 2), std::vector<size_t>({4, 7}));
+    EXPECT_EQ(n.get_hot_cache_stats().hits, 1);
+
+    n.push_front({"Tres", 31});
+    EXPECT_EQ(n.get_pos("Tres")[0], 0);
+    n.erase(0);
+    EXPECT_EQ(n.get_pos("Tres")[0], 4);
+    n.erase(1);
+    EXPECT_EQ(n.get_pos("Tres")[0], 3);
+    n.move(3, 0);
+    EXPECT_EQ(n.get_pos("Tres")[0], 0);
+    n.swap(0, 5);
+    EXPECT_EQ(n.get_pos("Tres")[0], 5);
+    n.set({"Cinco", 5}, 5);
+    EXPECT_EQ(n.get_pos("Tres")[0], 6);
+    n.sort_by();
+    EXPECT_EQ(n.get_pos("Uno", 1, 2), std::vector<size_t>({5, 6}));
+    n.clear();
+    EXPECT_TRUE(n.get_pos("Uno").empty());
+
+    com::hot_cache_stats stats = n.get_hot_cache_stats();
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 10);
+
+    // Changing only values keeps the positions.
+    vmap m = {{"Cero", 0}, {"Uno", 1}};
+    m.set_hot_cache(1);
+    m.get_pos("Uno");
+    m.set({"Uno", 2}, 1);
+    m.set_value(3, 1);
+    EXPECT_EQ(m.get_value("Uno")[0], 3);
+    EXPECT_EQ(m.get_hot_cache_stats().hits, 1);
+}
+
+TEST_F(VectorMapTestHotCache, Replacement) {
+    for (size_t i = 0; i < 3; ++i) {
+        n.get_pos("Uno");
+        n.get_pos("Dos");
+    }
+    EXPECT_EQ(n.get_hot_cache_stats().hits, 4);
+
+    // The cache is full: Tres only displaces Uno once it has worn down its three hits.
+    for (size_t i = 0; i < 3; ++i) {
+        EXPECT_EQ(n.get_pos("Tres")[0], 4);
+    }
+    EXPECT_EQ(n.get_hot_cache_stats().misses, 5);
+    EXPECT_EQ(n.get_pos("Tres")[0], 4);
+    EXPECT_EQ(n.get_pos("Dos")[0], 2);
+    EXPECT_EQ(n.get_hot_cache_stats().hits, 6);
+    EXPECT_EQ(n.get_pos("Uno")[0], 1);
+    EXPECT_EQ(n.get_hot_cache_stats().misses, 6);
+}
+
+TEST_F(VectorMapTestHotCache, CopyMoveSwap) {
+    n.get_pos("Tres");
+
+    vmap copy(n);
+    EXPECT_EQ(copy.hot_cache(), 2);
+    EXPECT_EQ(copy.get_pos("Tres")[0], 4);
+    EXPECT_EQ(copy.get_hot_cache_stats().hits, 1);
+
+    vmap other = {{"Tres", 3}};
+    other.swap(other, copy);
+    EXPECT_EQ(other.get_pos("Tres")[0], 4);
+    EXPECT_EQ(copy.hot_cache(), 0);
+    EXPECT_EQ(copy.get_pos("Tres")[0], 0);
+
+    vmap moved(std::move(other));
+    EXPECT_EQ(moved.get_pos("Tres")[0], 4);
+    EXPECT_EQ(moved.get_hot_cache_stats().hits, 3);
+
+    n.set_hot_cache(0);
+    EXPECT_EQ(n.get_pos("Tres")[0], 4);
+    EXPECT_EQ(n.get_hot_cache_stats().hits, 0);
+}
+
+TEST_F(VectorMapTestHotCache, MemoryUsage) {
+    // Only the long key owns heap memory before the cache is enabled.
+    vmap m = {{"Cero", 0}, {std::string(100, 'x'), 1}};
+    EXPECT_EQ(m.memory_usage().heap_bytes, 101);
+
+    m.set_hot_cache(64);
+    size_t reserved = m.memory_usage().heap_bytes - 101;
+    EXPECT_GE(reserved, 64 * sizeof(std::string));
+
+    // A cached copy of the long key owns its own buffer.
+    m.get_pos(std::string(100, 'x'));
+    EXPECT_EQ(m.memory_usage().heap_bytes, 101 + reserved + 101);
+
+    m.set_hot_cache(0);
+    EXPECT_EQ(m.memory_usage().heap_bytes, 101);
+}
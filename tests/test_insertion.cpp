@@ -1,6 +1,9 @@
 #include "vectormap.hpp"
 #include "gtest/gtest.h"
 
+#include <string_view>
+#include <vector>
+
 using  vmap = com::vectormap<std::string, size_t, 3>;
 
 class VectorMapTestInsertion : public ::testing::Test {
@@ -52,6 +55,16 @@ TEST_F(VectorMapTestInsertion, InsertInitList) {
     EXPECT_EQ(it->second, 9);
 }
 
+TEST_F(VectorMapTestInsertion, InsertInitListKeepsElements) {
+    n.insert({{"Nueve", 9}, {"Diez", 10}, {"Once", 11}}, 2);
+
+    std::vector<vmap::key_type> keys = {"Cero", "Uno", "Nueve", "Diez", "Once", "Dos", "Tres", "Cuatro", "Cinco", "Seis", "Siete", "Ocho"};
+    ASSERT_EQ(n.size(), keys.size());
+    for (vmap::size_type i = 0; i < keys.size(); ++i) {
+        EXPECT_EQ(n.get_key(i), keys[i]);
+    }
+}
+
 TEST_F(VectorMapTestInsertion, InsertVectormap) {
     vmap p = {{"Nueve", 9}, {"Diez", 10}};
     vmap::iterator it = n.insert(p, 3);
@@ -180,3 +193,27 @@ TEST_F(VectorMapTestInsertion, PushFrontVectormap) {
     EXPECT_EQ(it->first, "Nueve");
     EXPECT_EQ(it->second, 9);
 }
+
+TEST_F(VectorMapTestInsertion, InsertOwnElement) {
+    // Moved-from vectors are empty, so shifting the source before copying it would show.
+    using lmap = com::vectormap<std::string_view, std::vector<int>, 3>;
+    lmap m = {{"Uno", {1, 2, 3}}, {"Dos", {4, 5}}};
+
+    // In place, then growing.
+    m.insert(m.data()[0], 0);
+    m.insert(m.data()[2], 1);
+    ASSERT_EQ(m.size(), 4);
+    EXPECT_EQ(m.get_value(size_t(0)), std::vector<int>({1, 2, 3}));
+    EXPECT_EQ(m.get_value(1), std::vector<int>({4, 5}));
+    EXPECT_EQ(m.get_value(2), std::vector<int>({1, 2, 3}));
+    EXPECT_EQ(m.get_value(3), std::vector<int>({4, 5}));
+
+    m.reserve(6);
+    m.emplace(1, m.data()[3].first, m.data()[3].second);
+    m.emplace(0, m.data()[4].first, m.data()[0].second);
+    ASSERT_EQ(m.size(), 6);
+    EXPECT_EQ(m.get_key(size_t(0)), "Dos");
+    EXPECT_EQ(m.get_value(size_t(0)), std::vector<int>({1, 2, 3}));
+    EXPECT_EQ(m.get_value(2), std::vector<int>({4, 5}));
+    EXPECT_EQ(m.get_value(5), std::vector<int>({4, 5}));
+}
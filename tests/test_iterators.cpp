@@ -0,0 +1,81 @@
+#include "vectormap.hpp"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <ranges>
+#include <span>
+
+using vmap = com::vectormap<std::string, size_t, 3>;
+
+static_assert(std::contiguous_iterator<vmap::iterator>);
+static_assert(std::contiguous_iterator<vmap::const_iterator>);
+static_assert(std::ranges::contiguous_range<vmap>);
+static_assert(std::ranges::contiguous_range<const vmap>);
+static_assert(std::ranges::sized_range<vmap>);
+
+class VectorMapTestIterators : public ::testing::Test {
+    protected:
+        vmap n = {{"Cero", 0}, {"Uno", 1}, {"Dos", 2}, {"Tres", 3}, {"Cuatro", 4}, {"Cinco", 5}, {"Seis", 6}, {"Siete", 7}, {"Ocho", 8}};
+};
+
+TEST_F(VectorMapTestIterators, Arithmetic) {
+    vmap::iterator it = n.begin();
+
+    EXPECT_EQ(n.end() - n.begin(), 9);
+    EXPECT_EQ(it[4].first, "Cuatro");
+    EXPECT_EQ((3 + it)->first, "Tres");
+
+    it += 5;
+    EXPECT_EQ(it->first, "Cinco");
+    it -= 2;
+    EXPECT_EQ(it->first, "Tres");
+    EXPECT_TRUE(n.begin() < it);
+    EXPECT_TRUE(it <= n.end());
+    EXPECT_FALSE(it > n.end());
+}
+
+TEST_F(VectorMapTestIterators, ToAddress) {
+    EXPECT_EQ(std::to_address(n.begin()), n.data());
+    EXPECT_EQ(std::to_address(n.cbegin() + 2), n.data() + 2);
+    EXPECT_EQ(std::ranges::data(n), n.data());
+}
+
+TEST_F(VectorMapTestIterators, ConstIterator) {
+    const vmap& c = n;
+    vmap::const_iterator it = n.begin() + 1;
+
+    EXPECT_EQ(c.end() - it, 8);
+    EXPECT_EQ(it[1].first, "Dos");
+    EXPECT_EQ(c.rbegin()->first, "Ocho");
+    EXPECT_EQ(std::prev(c.rend())->first, "Cero");
+}
+
+TEST_F(VectorMapTestIterators, Algorithms) {
+    auto it = std::ranges::find(n, std::string("Seis"), &vmap::value_type::first);
+    EXPECT_EQ(it - n.begin(), 6);
+
+    auto lb = std::lower_bound(n.begin(), n.end(), 5, [](const vmap::value_type& a, size_t b) { return a.second < b; });
+    EXPECT_EQ(lb->first, "Cinco");
+
+    EXPECT_TRUE(std::ranges::is_sorted(n, {}, &vmap::value_type::second));
+    EXPECT_EQ(std::accumulate(n.cbegin(), n.cend(), size_t(0), [](size_t acc, const vmap::value_type& e) { return acc + e.second; }), 36);
+}
+
+TEST_F(VectorMapTestIterators, Span) {
+    std::span<vmap::value_type> s = n.span();
+
+    ASSERT_EQ(s.size(), 9);
+    EXPECT_EQ(s.data(), n.data());
+    EXPECT_EQ(s[8].first, "Ocho");
+
+    for (auto& elem : s) {
+        elem.second *= 2;
+    }
+    EXPECT_EQ(n.get_value(4), 8);
+
+    std::span<const vmap::value_type> cs = std::as_const(n).span();
+    EXPECT_EQ(cs.back().second, 16);
+}
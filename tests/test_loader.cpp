@@ -0,0 +1,73 @@
+#include "vectormap_loader.hpp"
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+
+using vmap = com::vectormap<std::string, size_t, 3>;
+
+class VectorMapTestLoader : public ::testing::Test {
+    protected:
+        std::string path = (std::filesystem::temp_directory_path() / "vectormap_test_loader.txt").string();
+
+        void SetUp() override {
+            std::ofstream file(path, std::ios::binary);
+            for (size_t i = 0; i < 20000; ++i) {
+                file << "key" << i << "=" << i * 3 << ((i % 7 == 0) ? "\r\n" : "\n");
+                if (i % 1000 == 0) {
+                    file << "\n";
+                }
+            }
+            file << "last=1";
+        }
+
+        void TearDown() override {
+            std::remove(path.c_str());
+        }
+
+        static std::optional<std::pair<std::string, size_t>> parse(std::string_view line) {
+            size_t sep = line.find('=');
+            if (sep == std::string_view::npos) {
+                return std::nullopt;
+            }
+            return std::make_pair(std::string(line.substr(0, sep)), std::stoul(std::string(line.substr(sep + 1))));
+        }
+
+        void check(vmap& m) {
+            ASSERT_EQ(m.size(), 20001);
+            for (size_t i = 0; i < 20000; ++i) {
+                ASSERT_EQ(m.get_key(i), "key" + std::to_string(i));
+                ASSERT_EQ(m.get_value(i), i * 3);
+            }
+            EXPECT_EQ(m.get_key(20000), "last");
+            EXPECT_EQ(m.capacity(), 20004);
+        }
+};
+
+TEST_F(VectorMapTestLoader, Load) {
+    vmap m = com::load<vmap>(path, parse);
+
+    check(m);
+}
+
+TEST_F(VectorMapTestLoader, LoadSmallBlocks) {
+    vmap m = com::load<vmap>(path, parse, {.block_size = 1000, .threads = 4});
+
+    check(m);
+}
+
+TEST_F(VectorMapTestLoader, LoadAsync) {
+    std::future<vmap> f = com::load_async<vmap>(path, parse, {.block_size = 4096});
+    vmap m = f.get();
+
+    check(m);
+}
+
+TEST_F(VectorMapTestLoader, MissingFile) {
+    std::future<vmap> f = com::load_async<vmap>(path + ".missing", parse);
+
+    EXPECT_THROW(f.get(), std::system_error);
+}
@@ -0,0 +1,147 @@
+#include "vectormap.hpp"
+#include "gtest/gtest.h"
+
+#include <string>
+
+using vmap = com::vectormap<std::string, size_t, 3>;
+
+namespace {
+    size_t allocations = 0;
+
+    template<class T>
+    struct counting_allocator {
+        using value_type = T;
+
+        counting_allocator() = default;
+        template<class U>
+        counting_allocator(const counting_allocator<U>&) {}
+
+        T* allocate(size_t n) {
+            ++allocations;
+            return std::allocator<T>().allocate(n);
+        }
+        void deallocate(T* p, size_t n) { std::allocator<T>().deallocate(p, n); }
+
+        bool operator==(const counting_allocator&) const { return true; }
+    };
+}
+
+struct blob {
+    size_t bytes = 0;
+};
+
+template<>
+struct com::heap_usage<blob> {
+    size_t operator()(const blob& b) const { return b.bytes; }
+};
+
+class VectorMapTestMemory : public ::testing::Test {
+    protected:
+        vmap n = {{"Cero", 0}, {"Uno", 1}, {"Dos", 2}, {"Tres", 3}, {"Cuatro", 4}, {"Cinco", 5}, {"Seis", 6}, {"Siete", 7}, {"Ocho", 8}};
+};
+
+TEST_F(VectorMapTestMemory, MemoryUsage) {
+    com::memory_report r = n.memory_usage();
+
+    EXPECT_EQ(r.object_bytes, sizeof(vmap));
+    EXPECT_EQ(r.buffer_bytes, 12 * sizeof(vmap::value_type));
+    EXPECT_EQ(r.used_bytes, 9 * sizeof(vmap::value_type));
+    EXPECT_EQ(r.heap_bytes, 0);
+
+    n.push_back(std::string(100, 'x'), 9);
+    EXPECT_GE(n.memory_usage().heap_bytes, 101);
+    EXPECT_EQ(n.memory_usage().total(), sizeof(vmap) + 12 * sizeof(vmap::value_type) + n.memory_usage().heap_bytes);
+}
+
+TEST_F(VectorMapTestMemory, CustomHeapUsage) {
+    com::vectormap<std::string, blob, 3> m = {{"a", {10}}, {"b", {32}}};
+
+    EXPECT_EQ(m.memory_usage().heap_bytes, 42);
+}
+
+TEST_F(VectorMapTestMemory, ShrinkPolicy) {
+    n.set_shrink_policy(0.5);
+    EXPECT_EQ(n.shrink_policy(), 0.5);
+
+    n.erase(0);
+    n.erase(0);
+    n.erase(0);
+    EXPECT_EQ(n.capacity(), 12);
+
+    n.erase(0);
+    ASSERT_EQ(n.size(), 5);
+    EXPECT_EQ(n.capacity(), 6);
+    EXPECT_EQ(n.get_key(0), "Cuatro");
+    EXPECT_EQ(n.get_key(4), "Ocho");
+
+    n.clear();
+    EXPECT_EQ(n.capacity(), 3);
+
+    n.set_shrink_policy(2.0);
+    EXPECT_EQ(n.shrink_policy(), 1.0);
+    n.set_shrink_policy(-1.0);
+    EXPECT_EQ(n.shrink_policy(), 0.0);
+}
+
+TEST_F(VectorMapTestMemory, ShrinkPolicyKeepsRoundedCapacity) {
+    com::vectormap<std::string, size_t, 100> m;
+    for (size_t i = 0; i < 950; ++i) {
+        m.push_back(std::to_string(i), i);
+    }
+    ASSERT_EQ(m.capacity(), 1000);
+    m.set_shrink_policy(0.95);
+
+    // Down to 900 elements the rounded capacity is still 1000, so the buffer is kept.
+    auto data = m.data();
+    while (m.size() > 900) {
+        m.erase(0);
+    }
+    EXPECT_EQ(m.data(), data);
+    EXPECT_EQ(m.capacity(), 1000);
+
+    m.erase(0);
+    EXPECT_EQ(m.capacity(), 900);
+    EXPECT_EQ(m.get_value(0), 51);
+}
+
+TEST_F(VectorMapTestMemory, MoveAssignmentDoesNotShrink) {
+    using cmap = com::vectormap<std::string, size_t, 3, counting_allocator<std::pair<const std::string, size_t>>>;
+    cmap a = {{"Cero", 0}, {"Uno", 1}, {"Dos", 2}, {"Tres", 3}, {"Cuatro", 4}, {"Cinco", 5}, {"Seis", 6}, {"Siete", 7}};
+    cmap b = {{"Ocho", 8}};
+    a.set_shrink_policy(0.5);
+
+    size_t before = allocations;
+    a = std::move(b);
+    EXPECT_EQ(allocations, before);
+    ASSERT_EQ(a.size(), 1);
+    EXPECT_EQ(a.get_key(0), "Ocho");
+}
+
+TEST_F(VectorMapTestMemory, NoShrinkByDefault) {
+    n.clear();
+
+    EXPECT_EQ(n.capacity(), 12);
+}
+
+TEST_F(VectorMapTestMemory, Registry) {
+    static_assert(com::memory_registry::enabled);
+    com::memory_registry& registry = com::memory_registry::instance();
+    size_t maps = registry.live_maps();
+    size_t bytes = registry.buffer_bytes();
+
+    {
+        vmap a = n;
+        vmap b;
+        EXPECT_EQ(registry.live_maps(), maps + 2);
+        EXPECT_EQ(registry.buffer_bytes(), bytes + 12 * sizeof(vmap::value_type));
+
+        b = std::move(a);
+        a = n;
+        a.reserve(20);
+        EXPECT_EQ(registry.buffer_bytes(), bytes + 33 * sizeof(vmap::value_type));
+        EXPECT_GE(registry.peak_buffer_bytes(), registry.buffer_bytes());
+    }
+
+    EXPECT_EQ(registry.live_maps(), maps);
+    EXPECT_EQ(registry.buffer_bytes(), bytes);
+}
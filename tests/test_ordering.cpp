@@ -0,0 +1,95 @@
+#include "vectormap.hpp"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+
+using vmap = com::vectormap<std::string, size_t, 3>;
+
+class VectorMapTestOrdering : public ::testing::Test {
+    protected:
+        vmap n = {{"Cero", 0}, {"Uno", 1}, {"Dos", 2}, {"Tres", 3}, {"Dos", 4}, {"Cinco", 5}, {"Uno", 6}, {"Dos", 7}, {"Ocho", 8}};
+};
+
+TEST_F(VectorMapTestOrdering, StableSortByKey) {
+    n.stable_sort_by_key();
+
+    ASSERT_EQ(n.size(), 9);
+    EXPECT_EQ(n.get_key(0), "Cero");
+    EXPECT_EQ(n.get_key(1), "Cinco");
+    EXPECT_EQ(n.get_key(2), "Dos");
+    EXPECT_EQ(n.get_value(2), 2);
+    EXPECT_EQ(n.get_value(3), 4);
+    EXPECT_EQ(n.get_value(4), 7);
+    EXPECT_EQ(n.get_key(5), "Ocho");
+    EXPECT_EQ(n.get_key(6), "Tres");
+    EXPECT_EQ(n.get_value(7), 1);
+    EXPECT_EQ(n.get_value(8), 6);
+}
+
+TEST_F(VectorMapTestOrdering, SortByProjection) {
+    n.sort_by(&vmap::value_type::second, std::ranges::greater());
+
+    for (vmap::size_type i = 0; i < n.size(); ++i) {
+        EXPECT_EQ(n.get_value(i), 8 - i);
+    }
+    EXPECT_EQ(n.get_key(0), "Ocho");
+    EXPECT_EQ(n.get_key(8), "Cero");
+}
+
+TEST_F(VectorMapTestOrdering, SortByParallel) {
+    com::vectormap<std::string, size_t> big;
+    big.reserve(50000);
+    for (size_t i = 0; i < 50000; ++i) {
+        big.push_back(std::to_string((i * 7919) % 50000), i);
+    }
+
+    big.sort_by(com::parallel, [](const auto& e) { return std::stoul(e.first); });
+
+    ASSERT_EQ(big.size(), 50000);
+    for (size_t i = 0; i < big.size(); ++i) {
+        EXPECT_EQ(big.get_key(i), std::to_string(i));
+    }
+}
+
+TEST_F(VectorMapTestOrdering, DedupeKeepFirst) {
+    n.dedupe_keys();
+
+    ASSERT_EQ(n.size(), 6);
+    EXPECT_EQ(n.get_all_values("Dos"), std::vector<size_t>({2}));
+    EXPECT_EQ(n.get_all_values("Uno"), std::vector<size_t>({1}));
+    EXPECT_EQ(n.get_key(4), "Cinco");
+    EXPECT_EQ(n.get_key(5), "Ocho");
+}
+
+TEST_F(VectorMapTestOrdering, DedupeKeepLast) {
+    n.dedupe_keys(com::dedupe_policy::keep_last);
+
+    ASSERT_EQ(n.size(), 6);
+    EXPECT_EQ(n.get_key(0), "Cero");
+    EXPECT_EQ(n.get_key(1), "Tres");
+    EXPECT_EQ(n.get_key(2), "Cinco");
+    EXPECT_EQ(n.get_key(3), "Uno");
+    EXPECT_EQ(n.get_value(3), 6);
+    EXPECT_EQ(n.get_key(4), "Dos");
+    EXPECT_EQ(n.get_value(4), 7);
+}
+
+TEST_F(VectorMapTestOrdering, DedupeMerge) {
+    n.dedupe_keys([](size_t& kept, size_t&& dup) { kept += dup; });
+
+    ASSERT_EQ(n.size(), 6);
+    EXPECT_EQ(n.get_value(1), 7);
+    EXPECT_EQ(n.get_value(2), 13);
+}
+
+TEST_F(VectorMapTestOrdering, GroupByKey) {
+    n.group_by_key();
+
+    ASSERT_EQ(n.size(), 9);
+    std::vector<std::string> keys = {"Cero", "Uno", "Uno", "Dos", "Dos", "Dos", "Tres", "Cinco", "Ocho"};
+    std::vector<size_t> values = {0, 1, 6, 2, 4, 7, 3, 5, 8};
+    for (vmap::size_type i = 0; i < n.size(); ++i) {
+        EXPECT_EQ(n.get_key(i), keys[i]);
+        EXPECT_EQ(n.get_value(i), values[i]);
+    }
+}
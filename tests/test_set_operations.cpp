@@ -0,0 +1,129 @@
+#include "vectormap.hpp"
+#include "gtest/gtest.h"
+
+using vmap = com::vectormap<std::string, size_t, 3>;
+
+class VectorMapTestSetOperations : public ::testing::Test {
+    protected:
+        vmap a = {{"Cero", 0}, {"Uno", 1}, {"Dos", 2}, {"Tres", 3}, {"Dos", 4}, {"Cinco", 5}};
+        vmap b = {{"Uno", 1}, {"Cinco", 5}, {"Dos", 20}, {"Seis", 6}, {"Tres", 3}, {"Dos", 4}};
+
+        void expect_equal(vmap& x, vmap& y) {
+            ASSERT_EQ(x.size(), y.size());
+            for (vmap::size_type i = 0; i < x.size(); ++i) {
+                EXPECT_EQ(x.get_key(i), y.get_key(i));
+                EXPECT_EQ(x.get_value(i), y.get_value(i));
+            }
+        }
+};
+
+TEST_F(VectorMapTestSetOperations, Diff) {
+    vmap::patch p = com::diff(a, b);
+
+    ASSERT_EQ(p.size(), 4);
+    EXPECT_EQ(p.at(0).kind, com::edit_kind::removed);
+    EXPECT_EQ(p.at(0).key, "Cero");
+    EXPECT_EQ(p.at(0).from, 0);
+    EXPECT_EQ(p.at(1).kind, com::edit_kind::moved);
+    EXPECT_EQ(p.at(1).key, "Cinco");
+    EXPECT_EQ(p.at(1).from, 5);
+    EXPECT_EQ(p.at(1).to, 1);
+    EXPECT_EQ(p.at(2).kind, com::edit_kind::changed);
+    EXPECT_EQ(p.at(2).key, "Dos");
+    EXPECT_EQ(p.at(2).from, 2);
+    EXPECT_EQ(p.at(2).value, 20);
+    EXPECT_EQ(p.at(3).kind, com::edit_kind::added);
+    EXPECT_EQ(p.at(3).key, "Seis");
+    EXPECT_EQ(p.at(3).to, 3);
+}
+
+TEST_F(VectorMapTestSetOperations, DiffIdentical) {
+    vmap c = a;
+
+    EXPECT_TRUE(com::diff(a, c).empty());
+}
+
+TEST_F(VectorMapTestSetOperations, Apply) {
+    ASSERT_TRUE(a.apply(com::diff(a, b)));
+    expect_equal(a, b);
+
+    vmap e;
+    ASSERT_TRUE(e.apply(com::diff(e, b)));
+    expect_equal(e, b);
+
+    ASSERT_TRUE(b.apply(com::diff(b, vmap())));
+    EXPECT_EQ(b.size(), 0);
+}
+
+TEST_F(VectorMapTestSetOperations, ApplyInvalid) {
+    vmap::patch p = {{com::edit_kind::removed, "Cero", 0, 10, vmap::npos}};
+
+    EXPECT_FALSE(a.apply(p));
+    ASSERT_EQ(a.size(), 6);
+    EXPECT_EQ(a.get_key(0), "Cero");
+}
+
+TEST_F(VectorMapTestSetOperations, MergeKeepOurs) {
+    a.merge(b);
+
+    ASSERT_EQ(a.size(), 7);
+    EXPECT_EQ(a.get_value(2), 2);
+    EXPECT_EQ(a.get_key(6), "Seis");
+}
+
+TEST_F(VectorMapTestSetOperations, MergeKeepTheirs) {
+    a.merge(b, com::merge_policy::keep_theirs);
+
+    ASSERT_EQ(a.size(), 7);
+    EXPECT_EQ(a.get_value(2), 4);
+    EXPECT_EQ(a.get_value(4), 4);
+    EXPECT_EQ(a.get_key(6), "Seis");
+}
+
+TEST_F(VectorMapTestSetOperations, MergeKeepBoth) {
+    a.merge(b, com::merge_policy::keep_both);
+
+    ASSERT_EQ(a.size(), 12);
+    EXPECT_EQ(a.get_key(0), "Cero");
+    EXPECT_EQ(a.get_key(5), "Cinco");
+    for (vmap::size_type i = 0; i < b.size(); ++i) {
+        EXPECT_EQ(a.get_key(6 + i), b.get_key(i));
+        EXPECT_EQ(a.get_value(6 + i), b.get_value(i));
+    }
+}
+
+TEST_F(VectorMapTestSetOperations, MergeFunction) {
+    vmap c = {{"Seis", 60}, {"Uno", 10}, {"Seis", 600}};
+    a.merge(c, [](size_t& ours, const size_t& theirs) { ours += theirs; });
+
+    ASSERT_EQ(a.size(), 7);
+    EXPECT_EQ(a.get_value(1), 11);
+    EXPECT_EQ(a.get_key(6), "Seis");
+    EXPECT_EQ(a.get_value(6), 660);
+}
+
+TEST_F(VectorMapTestSetOperations, MergeSelf) {
+    a.merge(a, com::merge_policy::keep_both);
+
+    ASSERT_EQ(a.size(), 12);
+    for (vmap::size_type i = 0; i < 6; ++i) {
+        EXPECT_EQ(a.get_key(6 + i), a.get_key(i));
+        EXPECT_EQ(a.get_value(6 + i), a.get_value(i));
+    }
+
+    b.merge(b, [](size_t& ours, const size_t& theirs) { ours += theirs; });
+    ASSERT_EQ(b.size(), 6);
+    EXPECT_EQ(b.get_value(0), 2);
+    EXPECT_EQ(b.get_value(2), 44);
+    EXPECT_EQ(b.get_value(5), 4);
+}
+
+TEST_F(VectorMapTestSetOperations, Intersect) {
+    vmap c = {{"Dos", 0}, {"Cinco", 0}, {"Nueve", 0}};
+    a.intersect(c);
+
+    ASSERT_EQ(a.size(), 3);
+    EXPECT_EQ(a.get_value(0), 2);
+    EXPECT_EQ(a.get_value(1), 4);
+    EXPECT_EQ(a.get_value(2), 5);
+}
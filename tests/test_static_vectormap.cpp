@@ -0,0 +1,63 @@
+#include "static_vectormap.hpp"
+#include "gtest/gtest.h"
+
+#include <string_view>
+
+using smap = com::static_vectormap<std::string_view, size_t, 9>;
+
+constexpr smap table({{"Cero", 0}, {"Uno", 1}, {"Dos", 2}, {"Tres", 3}, {"Dos", 4}, {"Cinco", 5}, {"Seis", 6}, {"Dos", 7}, {"Ocho", 8}});
+
+static_assert(table.size() == 9);
+static_assert(table.get_value("Seis") == 6);
+static_assert(table.get_pos("Dos", 3) == 7);
+static_assert(table.get_pos("Nueve") == smap::npos);
+static_assert(table.get_key(5) == "Cinco");
+static_assert(!table.contains("Diez"));
+static_assert(!std::constructible_from<smap, const smap::value_type (&)[8]>);
+
+// The key returned by an out of range access is value-initialized, as in vectormap.
+struct no_default_key {
+    constexpr no_default_key(int) {}
+    constexpr bool operator==(const no_default_key&) const = default;
+};
+template<class K>
+concept static_key = requires { typename com::static_vectormap<K, int, 1>; };
+static_assert(static_key<std::string_view>);
+static_assert(!static_key<no_default_key>);
+
+struct unordered_key {
+    std::string_view name;
+    constexpr bool operator==(const unordered_key&) const = default;
+};
+
+TEST(StaticVectorMapTest, Access) {
+    EXPECT_EQ(table.get(2)->first, "Dos");
+    EXPECT_EQ(table.get(9), table.end());
+    EXPECT_EQ(table.get("Ocho")->second, 8);
+    EXPECT_EQ(table.get_pos("Dos"), 2);
+    EXPECT_EQ(table.get_pos("Dos", 2), 4);
+    EXPECT_EQ(table.get_pos("Dos", 4), smap::npos);
+    EXPECT_EQ(table.get_value(20), 0);
+    EXPECT_EQ(table.end() - table.begin(), 9);
+}
+
+TEST(StaticVectorMapTest, EveryKey) {
+    for (size_t i = 0; i < table.size(); ++i) {
+        size_t ordinal = 1;
+        for (size_t j = 0; j < i; ++j) {
+            ordinal += (table.get_key(j) == table.get_key(i));
+        }
+        EXPECT_EQ(table.get_pos(table.get_key(i), ordinal), i);
+    }
+    EXPECT_FALSE(table.contains(""));
+    EXPECT_FALSE(table.contains("Zzz"));
+}
+
+TEST(StaticVectorMapTest, UnorderedKeys) {
+    constexpr com::static_vectormap<unordered_key, int, 3> t({{{"a"}, 1}, {{"b"}, 2}, {{"a"}, 3}});
+    static_assert(!decltype(t)::indexed);
+
+    EXPECT_EQ(t.get_value(unordered_key{"a"}, 2), 3);
+    EXPECT_EQ(t.get_pos(unordered_key{"b"}), 1);
+    EXPECT_FALSE(t.contains(unordered_key{"c"}));
+}
@@ -0,0 +1,697 @@
+#ifndef __VECTORMAPMODEL_H__
+#define __VECTORMAPMODEL_H__
+
+#include "vectormap.hpp"
+#include "compressed_vectormap.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Differential testing of vectormap against a std::vector of pairs.\n
+ *        Shared by the property tests and the libFuzzer target.
+ *
+ */
+namespace differential {
+    /**
+     * @brief Turns a byte string into bounded integers. Once exhausted it returns 0.
+     *
+     */
+    class byte_source {
+        public:
+            byte_source(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+            bool empty() const { return pos_ >= size_; }
+
+            size_t next(size_t bound) {
+                if (bound <= 1) {
+                    return 0;
+                }
+
+                size_t value = 0;
+                for (size_t range = 1; (range < bound) && !empty(); range <<= 8) {
+                    value = (value << 8) | data_[pos_++];
+                }
+                return value % bound;
+            }
+
+        private:
+            const uint8_t* data_;
+            size_t size_;
+            size_t pos_ = 0;
+    };
+
+    /**
+     * @brief Element of the model. Every new element gets a unique id that its copies keep, so
+     *        the model knows which element a handle was made for.
+     *
+     */
+    struct entry {
+        std::string first;
+        size_t second = 0;
+        size_t id = next_id_++;
+
+        entry(std::string key, size_t value) : first(std::move(key)), second(value) {}
+        template<class K>
+        entry(const std::pair<K, size_t>& elem) : entry(std::string(elem.first), elem.second) {}
+
+        private:
+            static inline size_t next_id_ = 0;
+    };
+
+    template<size_t delta_>
+    class vectormap_model {
+        public:
+            using map = com::vectormap<std::string, size_t, delta_>;
+            using model = std::vector<entry>;
+
+            /**
+             * @brief Runs operations decoded from src until it is exhausted.
+             *
+             * @return std::string  Empty if the vectormap always matched the model; otherwise the
+             *                      operations run so far and the first difference.
+             */
+            std::string run(byte_source& src) {
+                map_.set_hot_cache(src.next(4));
+                while (!src.empty()) {
+                    step_(src);
+                    if (error_.empty()) {
+                        check_(map_, model_, "after operation");
+                        check_handles_(map_, "after operation");
+                    }
+                    if (!error_.empty()) {
+                        return trace_.str() + "\n" + error_;
+                    }
+                }
+                return "";
+            }
+
+        private:
+            map map_;
+            model model_;
+            // Handles made on map_ and the id of the element each one was made for.
+            std::vector<std::pair<typename map::handle, size_t>> handles_;
+            std::ostringstream trace_;
+            std::string error_;
+
+            static constexpr size_t operations_ = 39;
+            static constexpr size_t tracked_handles_ = 32;
+
+            std::string key_(byte_source& src) { return "k" + std::to_string(src.next(6)); }
+            size_t value_(byte_source& src) { return src.next(1000); }
+
+            void fail_(const std::string& what) {
+                if (error_.empty()) {
+                    error_ = what;
+                }
+            }
+
+            void expect_(bool condition, const std::string& what) {
+                if (!condition) {
+                    fail_(what);
+                }
+            }
+
+            void check_(const map& m, const model& expected, const std::string& where) {
+                if (m.size() != expected.size()) {
+                    fail_(where + ": size " + std::to_string(m.size()) + " != " + std::to_string(expected.size()));
+                    return;
+                }
+                expect_(m.capacity() >= m.size(), where + ": capacity below size");
+                for (size_t i = 0; i < expected.size(); ++i) {
+                    if ((m.data()[i].first != expected[i].first) || (m.data()[i].second != expected[i].second)) {
+                        fail_(where + ": element " + std::to_string(i) + " is (" + m.data()[i].first + ", " + std::to_string(m.data()[i].second) +
+                              "), expected (" + expected[i].first + ", " + std::to_string(expected[i].second) + ")");
+                        return;
+                    }
+                }
+            }
+
+            size_t model_id_pos_(const model& m, size_t id) {
+                for (size_t i = 0; i < m.size(); ++i) {
+                    if (m[i].id == id) {
+                        return i;
+                    }
+                }
+                return map::npos;
+            }
+
+            void check_handles_(const map& m, const std::string& where) {
+                // A handle follows its element through every edit and goes stale when the element is erased.
+                for (const auto& [h, id] : handles_) {
+                    size_t pos = model_id_pos_(model_, id);
+                    if (pos != map::npos) {
+                        if (m.position(h) != pos) {
+                            fail_(where + ": handle resolves to " + std::to_string(m.position(h)) + ", expected " + std::to_string(pos));
+                            return;
+                        }
+                    }
+                    else if (m.is_valid(h)) {
+                        fail_(where + ": handle to an erased element is still valid");
+                        return;
+                    }
+                }
+            }
+
+            std::vector<size_t> model_get_(const model& m, const std::string& key, size_t ordinal, size_t number) {
+                std::vector<size_t> out;
+                size_t order = 1;
+                for (size_t i = 0; i < m.size(); ++i) {
+                    if (m[i].first == key) {
+                        if ((order >= ordinal) && (out.size() == (number - 1))) {
+                            out.push_back(i);
+                            return out;
+                        }
+                        else if (order >= ordinal) {
+                            out.push_back(i);
+                            ++order;
+                        }
+                        else {
+                            ++order;
+                        }
+                    }
+                }
+                return out;
+            }
+
+            size_t model_find_(const model& m, const std::string& key, size_t ordinal = 1) {
+                std::vector<size_t> found = model_get_(m, key, ordinal, 1);
+                return found.empty() ? map::npos : found[0];
+            }
+
+            void random_map_(byte_source& src, map& m, model& expected) {
+                size_t n = src.next(6);
+                for (size_t i = 0; i < n; ++i) {
+                    std::string k = key_(src);
+                    size_t v = value_(src);
+                    m.push_back(k, v);
+                    expected.emplace_back(k, v);
+                }
+            }
+
+            void check_inserted_(typename map::iterator it, size_t pos, size_t old_size, const std::string& key) {
+                if (pos > old_size) {
+                    expect_(it == map_.end(), "insertion out of range did not return end()");
+                }
+                else if (it != map_.end()) {
+                    expect_(it->first == key, "insertion returned a wrong iterator");
+                }
+            }
+
+            void step_(byte_source& src) {
+                size_t op = src.next(operations_);
+                size_t size = model_.size();
+                trace_ << op << " ";
+
+                switch (op) {
+                    case 0: {
+                        size_t pos = src.next(size + 2);
+                        std::pair<const std::string, size_t> val(key_(src), value_(src));
+                        auto it = map_.insert(val, pos);
+                        check_inserted_(it, pos, size, val.first);
+                        if (pos <= size) {
+                            model_.insert(model_.begin() + pos, val);
+                        }
+                        break;
+                    }
+                    case 1: {
+                        size_t pos = src.next(size + 2);
+                        std::string a = key_(src), b = key_(src), c = key_(src);
+                        size_t n = src.next(4);
+                        typename map::iterator it;
+                        switch (n) {
+                            case 0: it = map_.insert({}, pos); break;
+                            case 1: it = map_.insert({{a, 1}}, pos); break;
+                            case 2: it = map_.insert({{a, 1}, {b, 2}}, pos); break;
+                            default: it = map_.insert({{a, 1}, {b, 2}, {c, 3}}, pos); break;
+                        }
+                        if (pos <= size) {
+                            model block = {{a, 1}, {b, 2}, {c, 3}};
+                            model_.insert(model_.begin() + pos, block.begin(), block.begin() + n);
+                            if (n > 0) {
+                                check_inserted_(it, pos, size, a);
+                            }
+                        }
+                        else {
+                            check_inserted_(it, pos, size, a);
+                        }
+                        break;
+                    }
+                    case 2: {
+                        map other;
+                        model expected;
+                        random_map_(src, other, expected);
+                        size_t pos = src.next(size + 1);
+                        map_.insert(other, pos);
+                        model_.insert(model_.begin() + pos, expected.begin(), expected.end());
+                        break;
+                    }
+                    case 3: {
+                        size_t pos = src.next(size + 1);
+                        std::string k = key_(src);
+                        size_t v = value_(src);
+                        auto it = map_.emplace(pos, k, v);
+                        check_inserted_(it, pos, size, k);
+                        model_.insert(model_.begin() + pos, std::make_pair(k, v));
+                        break;
+                    }
+                    case 4: {
+                        std::string k = key_(src);
+                        size_t v = value_(src);
+                        map_.push_back(k, v);
+                        model_.emplace_back(k, v);
+                        break;
+                    }
+                    case 5: {
+                        std::string k = key_(src);
+                        size_t v = value_(src);
+                        map_.push_front(std::make_pair(k, v));
+                        model_.insert(model_.begin(), std::make_pair(k, v));
+                        break;
+                    }
+                    case 6: {
+                        size_t pos = src.next(size + 1);
+                        map_.erase(pos);
+                        if (pos < size) {
+                            model_.erase(model_.begin() + pos);
+                        }
+                        break;
+                    }
+                    case 7: {
+                        std::string k = key_(src);
+                        map_.erase(k);
+                        size_t pos = model_find_(model_, k);
+                        if (pos != map::npos) {
+                            model_.erase(model_.begin() + pos);
+                        }
+                        break;
+                    }
+                    case 8: {
+                        size_t a = src.next(size + 1), b = src.next(size + 1);
+                        map_.erase({a, b});
+                        for (size_t pos : {a, b}) {
+                            if (pos < model_.size()) {
+                                model_.erase(model_.begin() + pos);
+                            }
+                        }
+                        break;
+                    }
+                    case 9: {
+                        std::string k = key_(src);
+                        map_.erase_all(k);
+                        std::erase_if(model_, [&](const auto& e) { return e.first == k; });
+                        break;
+                    }
+                    case 10: {
+                        size_t from = src.next(size + 1), to = src.next(size + 1);
+                        map_.move(from, to);
+                        if ((from < size) && (to < size)) {
+                            auto elem = model_[from];
+                            model_.erase(model_.begin() + from);
+                            model_.insert(model_.begin() + to, elem);
+                        }
+                        break;
+                    }
+                    case 11: {
+                        size_t from = src.next(size + 1), to = src.next(size + 1);
+                        map_.swap(from, to);
+                        if ((from < size) && (to < size)) {
+                            std::swap(model_[from], model_[to]);
+                        }
+                        break;
+                    }
+                    case 12:
+                    case 14:
+                    case 16: {
+                        if (size == 0) {
+                            break;
+                        }
+                        size_t pos = src.next(size);
+                        std::string k = key_(src);
+                        size_t v = value_(src);
+                        if (op == 12) {
+                            map_.set(std::make_pair(k, v), pos);
+                            model_[pos].first = k;
+                            model_[pos].second = v;
+                        }
+                        else if (op == 14) {
+                            map_.set_value(v, pos);
+                            model_[pos].second = v;
+                        }
+                        else {
+                            map_.set_key(k, pos);
+                            model_[pos].first = k;
+                        }
+                        break;
+                    }
+                    case 13:
+                    case 15:
+                    case 17: {
+                        std::string key = key_(src);
+                        size_t ordinal = 1 + src.next(3);
+                        std::string k = key_(src);
+                        size_t v = value_(src);
+                        size_t pos = model_find_(model_, key, ordinal);
+                        if (op == 13) {
+                            map_.set(std::make_pair(k, v), key, ordinal);
+                            if (pos != map::npos) {
+                                model_[pos].first = k;
+                                model_[pos].second = v;
+                            }
+                        }
+                        else if (op == 15) {
+                            map_.set_value(v, key, ordinal);
+                            if (pos != map::npos) {
+                                model_[pos].second = v;
+                            }
+                        }
+                        else {
+                            map_.set_key(k, key, ordinal);
+                            if (pos != map::npos) {
+                                model_[pos].first = k;
+                            }
+                        }
+                        break;
+                    }
+                    case 18: {
+                        size_t pos = src.next(size + 1);
+                        auto it = map_.get(pos);
+                        if (pos < size) {
+                            expect_((it != map_.end()) && (it->first == model_[pos].first), "get(pos)");
+                            expect_(map_.get_value(pos) == model_[pos].second, "get_value(pos)");
+                            expect_(map_.get_key(pos) == model_[pos].first, "get_key(pos)");
+                        }
+                        else {
+                            expect_(it == map_.end(), "get(pos) out of range");
+                        }
+
+                        std::string key = key_(src);
+                        size_t ordinal = 1 + src.next(3);
+                        size_t number = 1 + src.next(3);
+                        std::vector<size_t> expected = model_get_(model_, key, ordinal, number);
+                        std::vector<size_t> all = model_get_(model_, key, 1, 0);
+
+                        auto got = map_.get(key, ordinal, number);
+                        expect_(got.size() == expected.size(), "get(key, ordinal, number) size");
+                        for (size_t i = 0; (i < got.size()) && (i < expected.size()); ++i) {
+                            expect_((got[i].second == expected[i]) && (got[i].first->second == model_[expected[i]].second), "get(key, ordinal, number)");
+                        }
+                        expect_(map_.get_pos(key, ordinal, number) == expected, "get_pos(key, ordinal, number)");
+                        expect_(map_.get_all_pos(key) == all, "get_all_pos(key)");
+                        expect_(map_.get_all(key).size() == all.size(), "get_all(key)");
+
+                        std::vector<size_t> values;
+                        for (size_t i : expected) {
+                            values.push_back(model_[i].second);
+                        }
+                        expect_(map_.get_value(key, ordinal, number) == values, "get_value(key, ordinal, number)");
+
+                        values.clear();
+                        for (size_t i : all) {
+                            values.push_back(model_[i].second);
+                        }
+                        expect_(map_.get_all_values(key) == values, "get_all_values(key)");
+
+                        std::string keys[3] = {key, key_(src), key_(src)};
+                        size_t positions[3];
+                        map_.lookup_batch(keys, positions);
+                        for (size_t i = 0; i < 3; ++i) {
+                            expect_(positions[i] == model_find_(model_, keys[i]), "lookup_batch()");
+                        }
+                        break;
+                    }
+                    case 19: {
+                        map copy(map_);
+                        check_(copy, model_, "copy constructor");
+                        check_handles_(copy, "copy constructor");
+                        map_ = std::move(copy);
+                        break;
+                    }
+                    case 20: {
+                        map other = {{"x", 1}};
+                        other = map_;
+                        check_(other, model_, "copy assignment");
+                        map_ = other;
+                        break;
+                    }
+                    case 21: {
+                        map moved(std::move(map_));
+                        expect_(map_.size() == 0, "moved-from vectormap is not empty");
+                        check_(moved, model_, "move constructor");
+                        check_handles_(moved, "move constructor");
+                        map_ = std::move(moved);
+                        break;
+                    }
+                    case 22: {
+                        if (src.next(4) == 0) {
+                            map_.clear();
+                            model_.clear();
+                        }
+                        break;
+                    }
+                    case 23: {
+                        switch (src.next(4)) {
+                            case 0: expect_(map_.reserve(size + src.next(10)), "reserve()"); break;
+                            case 1: expect_(map_.shrink(), "shrink()"); break;
+                            case 2: expect_(map_.resize(size + src.next(5)), "resize()"); break;
+                            default: map_.set_shrink_policy(double(src.next(3)) / 4); break;
+                        }
+                        break;
+                    }
+                    case 24: {
+                        map_.stable_sort_by_key();
+                        std::stable_sort(model_.begin(), model_.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+                        break;
+                    }
+                    case 25: {
+                        size_t policy = src.next(3);
+                        std::vector<bool> keep(size, false);
+                        for (size_t i = 0; i < size; ++i) {
+                            size_t first = model_find_(model_, model_[i].first);
+                            size_t count = model_get_(model_, model_[i].first, 1, 0).size();
+                            size_t last = model_find_(model_, model_[i].first, count);
+                            keep[i] = (policy == 1) ? (i == last) : (i == first);
+                            if ((policy == 2) && (i != first)) {
+                                model_[first].second += model_[i].second;
+                            }
+                        }
+                        if (policy == 0) {
+                            map_.dedupe_keys();
+                        }
+                        else if (policy == 1) {
+                            map_.dedupe_keys(com::dedupe_policy::keep_last);
+                        }
+                        else {
+                            map_.dedupe_keys([](size_t& kept, size_t&& dup) { kept += dup; });
+                        }
+                        model kept;
+                        for (size_t i = 0; i < size; ++i) {
+                            if (keep[i]) {
+                                kept.push_back(model_[i]);
+                            }
+                        }
+                        model_ = std::move(kept);
+                        break;
+                    }
+                    case 26: {
+                        map_.group_by_key();
+                        model grouped;
+                        for (size_t i = 0; i < size; ++i) {
+                            if (model_find_(model_, model_[i].first) == i) {
+                                for (size_t j : model_get_(model_, model_[i].first, 1, 0)) {
+                                    grouped.push_back(model_[j]);
+                                }
+                            }
+                        }
+                        model_ = std::move(grouped);
+                        break;
+                    }
+                    case 27: {
+                        typename map::batch b(map_);
+                        model pending = model_;
+                        size_t edits = src.next(8);
+                        for (size_t e = 0; e < edits; ++e) {
+                            if (src.next(2) == 0) {
+                                size_t pos = src.next(pending.size() + 1);
+                                std::string k = key_(src);
+                                size_t v = value_(src);
+                                b.insert(k, v, pos);
+                                pending.insert(pending.begin() + pos, std::make_pair(k, v));
+                            }
+                            else if (!pending.empty()) {
+                                size_t pos = src.next(pending.size());
+                                b.erase(pos);
+                                pending.erase(pending.begin() + pos);
+                            }
+                            if (!pending.empty()) {
+                                size_t pos = src.next(pending.size());
+                                auto p = b.get(pos);
+                                expect_((p != nullptr) && (p->first == pending[pos].first) && (p->second == pending[pos].second), "batch::get()");
+                            }
+                        }
+                        expect_(b.size() == pending.size(), "batch::size()");
+                        if (src.next(4) != 0) {
+                            b.commit();
+                            model_ = std::move(pending);
+                        }
+                        else {
+                            b.discard();
+                        }
+                        break;
+                    }
+                    case 28: {
+                        map other;
+                        model expected;
+                        random_map_(src, other, expected);
+                        expect_(map_.apply(com::diff(map_, other)), "apply(diff())");
+                        // diff() matches the n-th element of a key in both maps and apply() keeps its handles.
+                        for (size_t i = 0; i < expected.size(); ++i) {
+                            size_t ordinal = 1;
+                            for (size_t j = 0; j < i; ++j) {
+                                ordinal += (expected[j].first == expected[i].first);
+                            }
+                            size_t pos = model_find_(model_, expected[i].first, ordinal);
+                            if (pos != map::npos) {
+                                expected[i].id = model_[pos].id;
+                            }
+                        }
+                        model_ = std::move(expected);
+                        break;
+                    }
+                    case 29: {
+                        map other;
+                        model expected;
+                        random_map_(src, other, expected);
+                        size_t policy = src.next(3);
+                        map_.merge(other, static_cast<com::merge_policy>(policy));
+                        for (auto& elem : expected) {
+                            size_t pos = model_find_(model_, elem.first);
+                            if ((pos == map::npos) || (policy == size_t(com::merge_policy::keep_both))) {
+                                model_.push_back(elem);
+                            }
+                            else if (policy == size_t(com::merge_policy::keep_theirs)) {
+                                model_[pos].second = elem.second;
+                            }
+                        }
+                        break;
+                    }
+                    case 30: {
+                        map other;
+                        model expected;
+                        random_map_(src, other, expected);
+                        map_.intersect(other);
+                        std::erase_if(model_, [&](const auto& e) { return model_find_(expected, e.first) == map::npos; });
+                        break;
+                    }
+                    case 31: {
+                        map other;
+                        model expected;
+                        random_map_(src, other, expected);
+                        map_.swap(map_, other);
+                        check_(other, model_, "swap(a, b)");
+                        check_handles_(other, "swap(a, b)");
+                        // The handles went to other with its slots; map_ starts a new table.
+                        handles_.clear();
+                        model_ = std::move(expected);
+                        break;
+                    }
+                    case 32: {
+                        size_t pos = src.next(size + 2);
+                        std::string k = key_(src);
+                        size_t v = value_(src);
+                        std::error_code ec = map_.try_insert(std::make_pair(k, v), pos);
+                        expect_(bool(ec) == (pos > size), "try_insert()");
+                        if (pos <= size) {
+                            model_.insert(model_.begin() + pos, std::make_pair(k, v));
+                        }
+                        break;
+                    }
+                    case 33: {
+                        map_.sort_by(&map::value_type::second, std::ranges::greater());
+                        std::stable_sort(model_.begin(), model_.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+                        break;
+                    }
+                    case 34: {
+                        // A small cache keeps keys competing for its entries; the lookups of the
+                        // other operations check it against the model.
+                        map_.set_hot_cache(src.next(4));
+                        break;
+                    }
+                    case 35: {
+                        size_t pos = src.next(size + 1);
+                        typename map::handle h = map_.make_handle(pos);
+                        if (pos < size) {
+                            expect_(map_.position(h) == pos, "make_handle()");
+                            handles_.emplace_back(h, model_[pos].id);
+                            if (handles_.size() > tracked_handles_) {
+                                handles_.erase(handles_.begin());
+                            }
+                        }
+                        else {
+                            expect_(!map_.is_valid(h), "make_handle() out of range");
+                        }
+                        break;
+                    }
+                    case 36: {
+                        if (handles_.empty()) {
+                            break;
+                        }
+                        typename map::handle h = handles_[src.next(handles_.size())].first;
+                        map_.release(h);
+                        expect_(!map_.is_valid(h), "release()");
+                        std::erase_if(handles_, [&](const auto& tracked) { return tracked.first == h; });
+                        break;
+                    }
+                    case 37: {
+                        // Forced thread counts run the parallel copy, resize and destruction on any machine.
+                        size_t threshold = (src.next(2) == 0) ? map::npos : src.next(8);
+                        map_.set_parallel_threshold(threshold, 1 + src.next(3));
+                        expect_(map_.parallel_threshold() == threshold, "set_parallel_threshold()");
+                        break;
+                    }
+                    case 38: {
+                        com::compressed_vectormap<std::string, size_t, 4> c(map_);
+                        model expected = model_;
+                        size_t edits = src.next(24);
+                        for (size_t e = 0; e < edits; ++e) {
+                            if ((src.next(2) == 0) && !expected.empty()) {
+                                // Wide values force the block to be re-encoded.
+                                size_t pos = src.next(expected.size());
+                                size_t v = value_(src) << src.next(48);
+                                c.set_value(v, pos);
+                                expected[pos].second = v;
+                            }
+                            else {
+                                std::string k = key_(src);
+                                size_t v = value_(src);
+                                c.push_back(k, v);
+                                expected.emplace_back(k, v);
+                            }
+                        }
+
+                        if (c.size() != expected.size()) {
+                            fail_("compressed_vectormap: size " + std::to_string(c.size()) + " != " + std::to_string(expected.size()));
+                            break;
+                        }
+                        std::vector<size_t> decoded(expected.size());
+                        expect_(c.decode(0, decoded) == expected.size(), "compressed_vectormap::decode() count");
+                        for (size_t i = 0; i < expected.size(); ++i) {
+                            expect_(c.get_key(i) == expected[i].first, "compressed_vectormap::get_key()");
+                            expect_(c.get_value(i) == expected[i].second, "compressed_vectormap::get_value()");
+                            expect_(decoded[i] == expected[i].second, "compressed_vectormap::decode()");
+                        }
+                        std::string key = key_(src);
+                        size_t ordinal = 1 + src.next(3);
+                        expect_(c.get_pos(key, ordinal) == model_find_(expected, key, ordinal), "compressed_vectormap::get_pos()");
+                        check_(c.template decompress<delta_>(), expected, "compressed_vectormap::decompress()");
+                        break;
+                    }
+                }
+            }
+    };
+}
+#endif